@@ -4,6 +4,7 @@
 
 #pragma once
 // STL
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -12,12 +13,15 @@
 #include <theia/solvers/ransac.h>
 #include <theia/solvers/arrsac.h>
 #include <theia/solvers/estimator.h>
+#include <theia/solvers/model_prior.h>
+#include <theia/solvers/static_estimator.h>
 #include <theia/solvers/random_sampler.h>
 #include <theia/util/timer.h>
 
 
 // eigen
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 #include <Eigen/StdVector>
 
 // P3P
@@ -35,23 +39,75 @@ struct Match2D3D
     Eigen::Vector3d worldPoint;  // points in world coordinate system
 };
 
+// Normalized image coordinates of the bearing vectors, e.g. the positions used
+// by theia::ProgressiveNapsac to find spatially local samples.
+inline void NormalizedImagePositions(const vector<Match2D3D> &data,
+                                     vector<Vector2d> *positions)
+{
+    positions->resize(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        const Vector3d &featureVector( data[i].featureVector );
+        (*positions)[i] = featureVector.head<2>() / featureVector(2);
+    }
+}
+
 
-class P3PEstimator : public Estimator< Match2D3D, Matrix<double, 3, 4 > > {
+// The estimator is statically dispatched (see theia/solvers/static_estimator.h)
+// so that the per-point Error() calls made by the consensus loops can be
+// inlined.
+//
+// With use_fourth_point, minimal samples have four points (P3P+1): the poses
+// are computed from the first three and only the one that reprojects the fourth
+// best is returned, so a single model per sample is scored on all of the data
+// instead of up to four. Since the sample size is 4, the consensus loops
+// account for the extra point in their number of iterations.
+class P3PEstimator : public StaticEstimator< P3PEstimator, Match2D3D, Matrix<double, 3, 4 > > {
 public:
-    P3PEstimator():
-        Estimator< Match2D3D, Matrix<double, 3, 4> >(),
-        solver(){}
+    explicit P3PEstimator( bool use_fourth_point = false ):
+        StaticEstimator< P3PEstimator, Match2D3D, Matrix<double, 3, 4> >(),
+        solver(),
+        use_fourth_point_( use_fourth_point ){}
 
 // Get the minimum number of samples needed to generate a model.
-    virtual double SampleSize() const {
-        return 3;
+    double SampleSize() const {
+        return use_fourth_point_ ? 4 : 3;
+    }
+
+    // With use_fourth_point, the fourth point of a sample selects the pose, so
+    // samples of the same points with a different fourth point differ.
+    bool SampleOrderMatters() const {
+        return use_fourth_point_;
+    }
+
+    // Rejects near-degenerate samples before running the quartic solver:
+    // nearly coplanar bearings (which includes nearly parallel pairs), and world
+    // triangles that are nearly collinear or have nearly coincident vertices.
+    // The bearings are unit vectors, so their triple product is scale free. The
+    // world triangle is measured by 12 * |e1 x e2|^2 / (sum of |e_i|^2)^2,
+    // which is 1 for an equilateral triangle and 0 for a degenerate one.
+    bool ValidSample(const std::vector<Datum> &sample) const {
+        static const double kMinBearingVolume = 1e-6;
+        static const double kMinWorldTriangleQuality = 1e-4;
+        const Vector3d &f1( sample[0].featureVector );
+        const Vector3d &f2( sample[1].featureVector );
+        const Vector3d &f3( sample[2].featureVector );
+        if ( std::abs( f1.dot( f2.cross( f3 ) ) ) < kMinBearingVolume ) {
+            return false;
+        }
+
+        const Vector3d e1( sample[1].worldPoint - sample[0].worldPoint );
+        const Vector3d e2( sample[2].worldPoint - sample[0].worldPoint );
+        const double sum_sq_edges( e1.squaredNorm() + e2.squaredNorm() +
+                                   ( e2 - e1 ).squaredNorm() );
+        return 12.0 * e1.cross( e2 ).squaredNorm() >=
+               kMinWorldTriangleQuality * sum_sq_edges * sum_sq_edges;
     }
 
     // Given a set of data points, estimate the model. Users should implement this
     // function appropriately for the task being solved. Returns true for
     // successful model estimation (and outputs model), false for failed
     // estimation. Typically, this is a minimal set, but it is not required to be.
-    virtual bool EstimateModel(const std::vector<Datum> &data, std::vector<Model> *model) const {
+    bool EstimateModel(const std::vector<Datum> &data, std::vector<Model> *model) const {
         assert(data.size() >= 3);
         Matrix3d featureVectors;
         Matrix3d worldPoints;
@@ -70,15 +126,43 @@ public:
         if ( model->empty() ){
             success = -1;
         }
+        // Disambiguate the poses with the fourth point.
+        if ( use_fourth_point_ && data.size() > 3 && model->size() > 1 ) {
+            size_t best( 0 );
+            double best_error( Error( data[3], ( *model )[0] ) );
+            for (size_t i = 1; i < model->size(); ++i) {
+                const double error( Error( data[3], ( *model )[i] ) );
+                if ( error < best_error ) {
+                    best_error = error;
+                    best = i;
+                }
+            }
+            ( *model )[0] = ( *model )[best];
+            model->resize( 1 );
+        }
         if ( success == -1 ){
             return false;
         }else{
             return true;
         }
     }
+  // A pose is only kept if the sample it was computed from is in front of the
+  // camera and reprojected within the threshold, which drops the spurious
+  // roots of the quartic before they are scored on all of the data. Error()
+  // penalizes points behind the camera, so this covers the cheirality check.
+  bool ValidModelForSample(const std::vector<Datum> &sample, const Model &model,
+                           const double error_thresh) const {
+      for (size_t i = 0; i < sample.size(); ++i) {
+          if ( Error( sample[i], model ) >= error_thresh ) {
+              return false;
+          }
+      }
+      return true;
+  }
+
   // Given a model and a data point, calculate the error. Users should implement
   // this function appropriately for the task being solved.
-  virtual double Error(const Datum& data, const Model& model) const {
+  double Error(const Datum& data, const Model& model) const {
       // model is gwc
       const Vector3d &worldPoint( data.worldPoint );
       Vector3d proj( model.block<3,3>(0,0).transpose()*( worldPoint - model.block<3,1>(0,3) ) );
@@ -92,6 +176,36 @@ public:
   }
 private:
     P3P_Kneip solver;
+    bool use_fourth_point_;
+};
+
+// A pose prior (e.g. from odometry or an IMU) given as a predicted pose gwc and
+// bounds on the rotation angle and on the distance of the camera center. Both
+// bounds are checked in O(1): the rotation angle between R0 and R is at most
+// max_rotation_angle iff trace(R0^T R) >= 1 + 2 cos(max_rotation_angle).
+class PosePrior : public ModelPrior< Matrix<double, 3, 4> > {
+public:
+    // Params:
+    //   pose: The predicted pose gwc.
+    //   max_rotation_angle: The maximum rotation angle in radians.
+    //   max_translation: The maximum distance of the camera center.
+    PosePrior( const Matrix<double, 3, 4> &pose, double max_rotation_angle,
+               double max_translation ):
+        pose_( pose ),
+        min_trace_( 1.0 + 2.0 * std::cos( max_rotation_angle ) ),
+        max_sq_translation_( max_translation * max_translation ){}
+
+    bool IsConsistent( const Matrix<double, 3, 4> &model ) const {
+        const double trace( pose_.block<3,3>(0,0).cwiseProduct(
+                                model.block<3,3>(0,0) ).sum() );
+        return trace >= min_trace_ &&
+               ( model.col(3) - pose_.col(3) ).squaredNorm() <=
+                   max_sq_translation_;
+    }
+private:
+    Matrix<double, 3, 4> pose_;
+    double min_trace_;
+    double max_sq_translation_;
 };
 
 //     // setup ransac parameters
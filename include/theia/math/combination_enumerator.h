@@ -0,0 +1,84 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_MATH_COMBINATION_ENUMERATOR_H_
+#define THEIA_MATH_COMBINATION_ENUMERATOR_H_
+
+#include <glog/logging.h>
+#include <vector>
+
+namespace theia {
+// Enumerates the k-subsets of {0, ..., n - 1} in lexicographic order. The
+// enumeration may start at any rank, so that the subsets can be split into
+// contiguous ranges, e.g. one per thread.
+class CombinationEnumerator {
+ public:
+  CombinationEnumerator() : n_(0) {}
+  CombinationEnumerator(const int n, const int k) { Reset(n, k); }
+
+  // Restarts the enumeration at the first k-subset of n elements. The memory
+  // of the indices is reused if k is not larger than before.
+  void Reset(const int n, const int k) {
+    CHECK_GE(n, k);
+    CHECK_GT(k, 0);
+    n_ = n;
+    indices_.resize(k);
+    SeekToRank(0);
+  }
+
+  // The number of k-subsets of n elements, C(n, k). Every intermediate value
+  // is a binomial coefficient, so the result is exact as long as it is below
+  // 2^53.
+  static double NumCombinations(const int n, const int k) {
+    double num_combinations = 1.0;
+    for (int i = 0; i < k; i++) {
+      num_combinations = num_combinations * (n - i) / (i + 1);
+    }
+    return num_combinations;
+  }
+
+  // Moves to the subset of the given lexicographic rank in O(n).
+  void SeekToRank(double rank) {
+    const int k = indices_.size();
+    int candidate = 0;
+    for (int i = 0; i < k; i++, candidate++) {
+      // Skip the candidates whose subsets all have a lower rank.
+      double num_with_candidate;
+      while (rank >= (num_with_candidate =
+                          NumCombinations(n_ - 1 - candidate, k - 1 - i))) {
+        rank -= num_with_candidate;
+        candidate++;
+      }
+      indices_[i] = candidate;
+    }
+  }
+
+  // Moves to the next subset. Returns false if the current subset is the last
+  // one.
+  bool Next() {
+    const int k = indices_.size();
+    int i = k - 1;
+    while (i >= 0 && indices_[i] == n_ - k + i) {
+      i--;
+    }
+    if (i < 0) {
+      return false;
+    }
+    indices_[i]++;
+    for (int j = i + 1; j < k; j++) {
+      indices_[j] = indices_[j - 1] + 1;
+    }
+    return true;
+  }
+
+  // The sorted indices of the current subset.
+  const std::vector<int>& Indices() const { return indices_; }
+
+ private:
+  int n_;
+  std::vector<int> indices_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_COMBINATION_ENUMERATOR_H_
@@ -4,6 +4,7 @@
 #ifndef THEIA_MATH_DISTRIBUTION_H_
 #define THEIA_MATH_DISTRIBUTION_H_
 
+#include <Eigen/Core>
 #include <glog/logging.h>
 #include <stdio.h>
 #include <cmath>
@@ -19,6 +20,19 @@ class Distribution {
   // variables of a derived class, you should implement the changes in a
   // different method (i.e. an Update method)
   virtual double eval(double x) const = 0;
+
+  // Evaluates the distribution at each of the num_values values x, e.g. the
+  // residuals of a model, and writes the results to values. The default
+  // implementation calls eval on each value. Derived classes should override
+  // it with a vectorized implementation so that the distribution can be
+  // evaluated on many values at the cost of a single virtual call.
+  virtual void EvalBatch(const double* x,
+                         const int num_values,
+                         double* values) const {
+    for (int i = 0; i < num_values; i++) {
+      values[i] = eval(x[i]);
+    }
+  }
 };
 
 // Normal Gaussian Distribution.
@@ -36,6 +50,12 @@ class NormalDistribution : public Distribution {
   double eval(double x) const {
     return alpha_ * exp(beta_ * x * x); }
 
+  void EvalBatch(const double* x, const int num_values, double* values) const {
+    const Eigen::Map<const Eigen::ArrayXd> x_array(x, num_values);
+    Eigen::Map<Eigen::ArrayXd>(values, num_values) =
+        alpha_ * (beta_ * x_array.square()).exp();
+  }
+
  private:
   // Normal factor.
   double alpha_;
@@ -43,6 +63,30 @@ class NormalDistribution : public Distribution {
   double beta_;
 };
 
+// Exponential distribution with the given rate, e.g. of the squared norm of a
+// 2D Gaussian error, which is exponential with rate 1 / (2 * sigma^2). The
+// probability is 0 for negative x.
+class ExponentialDistribution : public Distribution {
+ public:
+  explicit ExponentialDistribution(const double& rate) : rate_(rate) {
+    CHECK_GT(rate, 0)
+        << "The rate must be greater than zero in an exponential distribution";
+  }
+
+  ~ExponentialDistribution() {}
+
+  double eval(double x) const { return x >= 0 ? rate_ * exp(-rate_ * x) : 0; }
+
+  void EvalBatch(const double* x, const int num_values, double* values) const {
+    const Eigen::Map<const Eigen::ArrayXd> x_array(x, num_values);
+    Eigen::Map<Eigen::ArrayXd>(values, num_values) =
+        (x_array >= 0.0).cast<double>() * rate_ * (-rate_ * x_array).exp();
+  }
+
+ private:
+  const double rate_;
+};
+
 // Uniform distribution between left and right. Probability is uniform when x is
 // within this span, and 0 when x is outside of the span.
 class UniformDistribution : public Distribution {
@@ -63,6 +107,13 @@ class UniformDistribution : public Distribution {
     return (left_ <= x && x <= right_) ? inverse_span_ : 0;
   }
 
+  void EvalBatch(const double* x, const int num_values, double* values) const {
+    const Eigen::Map<const Eigen::ArrayXd> x_array(x, num_values);
+    Eigen::Map<Eigen::ArrayXd>(values, num_values) =
+        ((x_array >= left_) && (x_array <= right_)).cast<double>() *
+        inverse_span_;
+  }
+
  protected:
   const double left_;
   const double right_;
@@ -0,0 +1,184 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_MATH_GRAPH_DENSE_CONNECTED_COMPONENTS_H_
+#define THEIA_MATH_GRAPH_DENSE_CONNECTED_COMPONENTS_H_
+
+#include <glog/logging.h>
+#ifdef THEIA_USE_OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace theia {
+
+// A union-find structure over the dense node ids 0, ..., num_nodes - 1, e.g.
+// the indices of correspondences or hypotheses. Unlike ConnectedComponents,
+// which maps arbitrary node ids through a hash map, the parent and the size of
+// each node are stored in contiguous arrays. The roots are found with path
+// halving and the components are merged by size, so that any sequence of
+// operations runs in nearly linear time. Use ConnectedComponents for sparse or
+// non-integer node ids.
+class DenseConnectedComponents {
+ public:
+  explicit DenseConnectedComponents(const int num_nodes)
+      : parent_(num_nodes), size_(num_nodes, 1) {
+    CHECK_GE(num_nodes, 0);
+    for (int i = 0; i < num_nodes; i++) {
+      parent_[i] = i;
+    }
+  }
+
+  int NumNodes() const { return parent_.size(); }
+
+  // Merges the connected components of the two nodes.
+  void AddEdge(const int node1, const int node2) {
+    Union(node1, node2, &parent_, &size_);
+  }
+
+  // Adds all of the edges. With OpenMP, the edges are split across threads
+  // that each build the components of their edges, and the components of the
+  // threads are then merged, which is O(num_threads * num_nodes).
+  void AddEdges(const std::vector<std::pair<int, int> >& edges) {
+    int num_threads = 1;
+#ifdef THEIA_USE_OPENMP
+    // Merging the components of a thread costs as much as adding num_nodes
+    // edges, so each thread needs more edges than that to pay off.
+    num_threads = std::max(
+        1,
+        std::min<int>(omp_get_max_threads(), edges.size() / (NumNodes() + 1)));
+#endif
+    if (num_threads == 1) {
+      for (const std::pair<int, int>& edge : edges) {
+        AddEdge(edge.first, edge.second);
+      }
+      return;
+    }
+
+    std::vector<std::vector<int> > parents(num_threads);
+    std::vector<std::vector<int> > sizes(num_threads);
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++) {
+      parents[t].resize(NumNodes());
+      sizes[t].assign(NumNodes(), 1);
+      for (int i = 0; i < NumNodes(); i++) {
+        parents[t][i] = i;
+      }
+      const int begin = static_cast<long long>(edges.size()) * t / num_threads;
+      const int end =
+          static_cast<long long>(edges.size()) * (t + 1) / num_threads;
+      for (int e = begin; e < end; e++) {
+        Union(edges[e].first, edges[e].second, &parents[t], &sizes[t]);
+      }
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+      for (int i = 0; i < NumNodes(); i++) {
+        if (parents[t][i] != i) {
+          AddEdge(i, parents[t][i]);
+        }
+      }
+    }
+  }
+
+  // Returns the representative node of the component of the node.
+  int FindRoot(const int node) { return FindRoot(node, &parent_); }
+
+  // Returns true if the two nodes are in the same connected component.
+  bool Connected(const int node1, const int node2) {
+    return FindRoot(node1) == FindRoot(node2);
+  }
+
+  // Extracts the connected components in CSR form: the nodes of component c
+  // are component_nodes[component_offsets[c]] to
+  // component_nodes[component_offsets[c + 1] - 1], in increasing order. The
+  // components are ordered by their smallest node. If labels is not null,
+  // labels[i] is set to the component of node i.
+  void Extract(std::vector<int>* component_offsets,
+               std::vector<int>* component_nodes,
+               std::vector<int>* labels = nullptr) {
+    CHECK_NOTNULL(component_offsets);
+    CHECK_NOTNULL(component_nodes);
+    const int num_nodes = NumNodes();
+
+    // Number the components in the order of their smallest node, using
+    // root_label to map each root to its component.
+    std::vector<int> root_label(num_nodes, -1);
+    std::vector<int> node_labels(num_nodes);
+    int num_components = 0;
+    for (int i = 0; i < num_nodes; i++) {
+      const int root = FindRoot(i);
+      if (root_label[root] < 0) {
+        root_label[root] = num_components++;
+      }
+      node_labels[i] = root_label[root];
+    }
+
+    // Bucket the nodes by component with a counting sort, which keeps them in
+    // increasing order within each component.
+    component_offsets->assign(num_components + 1, 0);
+    for (int i = 0; i < num_nodes; i++) {
+      (*component_offsets)[node_labels[i] + 1]++;
+    }
+    for (int c = 0; c < num_components; c++) {
+      (*component_offsets)[c + 1] += (*component_offsets)[c];
+    }
+    component_nodes->resize(num_nodes);
+    std::vector<int>& cursors = root_label;
+    std::copy(component_offsets->begin(), component_offsets->end() - 1,
+              cursors.begin());
+    for (int i = 0; i < num_nodes; i++) {
+      (*component_nodes)[cursors[node_labels[i]]++] = i;
+    }
+
+    if (labels != nullptr) {
+      labels->swap(node_labels);
+    }
+  }
+
+ private:
+  // Finds the root of the node with path halving: every other node on the
+  // path is linked to its grandparent.
+  static int FindRoot(int node, std::vector<int>* parent) {
+    std::vector<int>& parent_ref = *parent;
+    while (parent_ref[node] != node) {
+      parent_ref[node] = parent_ref[parent_ref[node]];
+      node = parent_ref[node];
+    }
+    return node;
+  }
+
+  // Merges the components of the two nodes, attaching the smaller tree to the
+  // larger one.
+  static void Union(const int node1,
+                    const int node2,
+                    std::vector<int>* parent,
+                    std::vector<int>* size) {
+    DCHECK_GE(node1, 0);
+    DCHECK_LT(node1, parent->size());
+    DCHECK_GE(node2, 0);
+    DCHECK_LT(node2, parent->size());
+    int root1 = FindRoot(node1, parent);
+    int root2 = FindRoot(node2, parent);
+    if (root1 == root2) {
+      return;
+    }
+    if ((*size)[root1] < (*size)[root2]) {
+      std::swap(root1, root2);
+    }
+    (*parent)[root2] = root1;
+    (*size)[root1] += (*size)[root2];
+  }
+
+  // The parent of each node, which is the node itself for a root.
+  std::vector<int> parent_;
+
+  // The size of the component of each root. Not meaningful for other nodes.
+  std::vector<int> size_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_GRAPH_DENSE_CONNECTED_COMPONENTS_H_
@@ -4,7 +4,13 @@
 #ifndef THEIA_MATH_HISTOGRAM_H_
 #define THEIA_MATH_HISTOGRAM_H_
 
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "theia/util/stringprintf.h"
@@ -13,28 +19,158 @@ namespace theia {
 
 // A simple histogram counter that will create a histogram composed of fixed
 // bins that are specified by the user.
+//
+// The bins may have arbitrary boundaries, in which case each value is binned
+// with a binary search, or be created with Uniform or LogUniform, in which case
+// the bin of a value is computed arithmetically in O(1). AddBatch bins arrays
+// of values (e.g. the residuals of a model), computing the bin positions with
+// vectorized Eigen array operations. Histograms with the same boundaries, e.g.
+// filled on different threads, can be combined with Merge. NaN values are
+// counted in the bin above the last boundary, like infinite values, so that
+// e.g. a NaN residual is never counted as an inlier.
 template <typename T>
 class Histogram {
  public:
   // Initialize the historgram with its bins. The boundaries vector must be
   // sorted.
   explicit Histogram(const std::vector<T>& boundaries)
-      : boundaries_(boundaries) {
+      : spacing_(kArbitrary), origin_(0.0), inverse_bin_width_(0.0) {
     // Insert the data type's min and max to the front and back respectively.
-    boundaries_.insert(boundaries_.begin(),
-                       -std::numeric_limits<T>::infinity());
+    // Integer types have no infinity, so their lowest value is used instead.
+    boundaries_.reserve(boundaries.size() + 2);
+    boundaries_.push_back(std::numeric_limits<T>::has_infinity
+                              ? -std::numeric_limits<T>::infinity()
+                              : std::numeric_limits<T>::lowest());
+    boundaries_.insert(boundaries_.end(), boundaries.begin(), boundaries.end());
     boundaries_.push_back(std::numeric_limits<T>::max());
     histogram_count_.resize(boundaries_.size());
   }
 
+  // Creates a histogram whose boundaries divide [min_value, max_value] into
+  // num_bins bins of equal width, in addition to the bins of the values below
+  // min_value and above max_value.
+  static Histogram Uniform(const T min_value,
+                           const T max_value,
+                           const int num_bins) {
+    CHECK_LT(min_value, max_value);
+    CHECK_GT(num_bins, 0);
+    const double bin_width =
+        (static_cast<double>(max_value) - min_value) / num_bins;
+    std::vector<T> boundaries(num_bins + 1);
+    for (int i = 0; i <= num_bins; i++) {
+      boundaries[i] = static_cast<T>(min_value + i * bin_width);
+    }
+    Histogram histogram(boundaries);
+    histogram.spacing_ = kUniform;
+    histogram.origin_ = min_value;
+    histogram.inverse_bin_width_ = 1.0 / bin_width;
+    return histogram;
+  }
+
+  // Creates a histogram whose boundaries divide [min_value, max_value] into
+  // num_bins bins of equal width in log space, in addition to the bins of the
+  // values below min_value and above max_value. min_value must be positive.
+  static Histogram LogUniform(const T min_value,
+                              const T max_value,
+                              const int num_bins) {
+    CHECK_GT(min_value, 0);
+    CHECK_LT(min_value, max_value);
+    CHECK_GT(num_bins, 0);
+    const double log_min_value = std::log(static_cast<double>(min_value));
+    const double log_bin_width =
+        (std::log(static_cast<double>(max_value)) - log_min_value) / num_bins;
+    std::vector<T> boundaries(num_bins + 1);
+    for (int i = 0; i <= num_bins; i++) {
+      boundaries[i] =
+          static_cast<T>(std::exp(log_min_value + i * log_bin_width));
+    }
+    Histogram histogram(boundaries);
+    histogram.spacing_ = kLogUniform;
+    histogram.origin_ = log_min_value;
+    histogram.inverse_bin_width_ = 1.0 / log_bin_width;
+    return histogram;
+  }
+
   // Add a value to the histogram. The value will be added to the appropriate
   // histogram bin.
   void Add(const T value) {
-    // Find the first boundary element that is greater than value.
-    const auto& it =
-        std::upper_bound(boundaries_.begin(), boundaries_.end(), value);
-    const int bin_index = std::distance(boundaries_.begin(), it) - 1;
-    ++histogram_count_[bin_index];
+    if (spacing_ == kArbitrary) {
+      // Find the first boundary element that is greater than value. Values
+      // that are not less than the last boundary, including NaN, for which
+      // every comparison is false, go to the bin above the last boundary.
+      const auto& it =
+          std::upper_bound(boundaries_.begin(), boundaries_.end() - 1, value);
+      const int bin_index = std::distance(boundaries_.begin(), it) - 1;
+      ++histogram_count_[bin_index];
+      return;
+    }
+
+    const double position =
+        spacing_ == kUniform
+            ? (value - origin_) * inverse_bin_width_
+            : (std::log(static_cast<double>(value)) - origin_) *
+                  inverse_bin_width_;
+    ++histogram_count_[BinIndex(value, position)];
+  }
+
+  // Adds num_values values to the histogram. For uniform and log-uniform bins,
+  // the bin positions of the values are computed in vectorized blocks.
+  void AddBatch(const T* values, const int num_values) {
+    if (spacing_ == kArbitrary) {
+      for (int i = 0; i < num_values; i++) {
+        Add(values[i]);
+      }
+      return;
+    }
+
+    // The smallest positive double, so that the logarithm of non-positive
+    // values is finite and maps them to the lowest bin.
+    const double min_positive_value = std::numeric_limits<double>::min();
+    Eigen::Array<double, kBlockSize, 1> positions;
+    for (int begin = 0; begin < num_values; begin += kBlockSize) {
+      const int block_size = std::min(kBlockSize, num_values - begin);
+      const Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1> > block(
+          values + begin, block_size);
+      if (spacing_ == kUniform) {
+        positions.head(block_size) =
+            (block.template cast<double>() - origin_) * inverse_bin_width_;
+      } else {
+        positions.head(block_size) =
+            (block.template cast<double>().max(min_positive_value).log() -
+             origin_) *
+            inverse_bin_width_;
+      }
+      for (int i = 0; i < block_size; i++) {
+        ++histogram_count_[BinIndex(values[begin + i], positions[i])];
+      }
+    }
+  }
+
+  // Adds the counts of a histogram with the same boundaries to this one.
+  void Merge(const Histogram& histogram) {
+    CHECK(boundaries_ == histogram.boundaries_)
+        << "Only histograms with the same boundaries can be merged.";
+    for (int i = 0; i < histogram_count_.size(); i++) {
+      histogram_count_[i] += histogram.histogram_count_[i];
+    }
+  }
+
+  // Resets the count of every bin to zero.
+  void Reset() {
+    std::fill(histogram_count_.begin(), histogram_count_.end(), 0);
+  }
+
+  // The number of bins, i.e. the number of boundaries plus one. Bin 0 holds the
+  // values below the first boundary, bin i the values in [boundaries[i - 1],
+  // boundaries[i]) and the last bin the values above the last boundary.
+  int NumBins() const { return boundaries_.size() - 1; }
+
+  // The ith boundary, i.e. the lower bound of bin i + 1.
+  T Boundary(const int i) const { return boundaries_[i + 1]; }
+
+  // The number of values added to the bin.
+  int BinCount(const int bin_index) const {
+    return histogram_count_[bin_index];
   }
 
   // Returns the histogram printed in a message. For example, a histogram with
@@ -44,44 +180,97 @@ class Histogram {
   //    [1 - 2) = 3
   //    [2 - 3) = 7
   //    > 3 = 2
-  std::string PrintString() {
-    std::string msg = "";
+  std::string PrintString() const {
+    // Every line is short, so reserving a few dozen characters per bin avoids
+    // growing the string while it is printed.
+    static const int kReservedCharactersPerBin = 48;
+    std::string msg;
+    msg.reserve(kReservedCharactersPerBin * histogram_count_.size());
 
     // Print the bin containing elements less then the lower bound. Only print
     // this range if the bin is not empty.
     if (histogram_count_.front() > 0) {
-      msg += theia::StringPrintf("< %s = %d",
-                                 std::to_string(boundaries_[1]).c_str(),
-                                 histogram_count_.front());
-      msg += "\n";
+      msg += "< ";
+      AppendValue(boundaries_[1], &msg);
+      StringAppendF(&msg, " = %d\n", histogram_count_.front());
     }
 
     for (int i = 1; i < boundaries_.size() - 2; i++) {
-      msg += theia::StringPrintf("[%s - %s) = %d ",
-                                 std::to_string(boundaries_[i]).c_str(),
-                                 std::to_string(boundaries_[i + 1]).c_str(),
-                                 histogram_count_[i]);
-      msg += "\n";
+      msg += "[";
+      AppendValue(boundaries_[i], &msg);
+      msg += " - ";
+      AppendValue(boundaries_[i + 1], &msg);
+      StringAppendF(&msg, ") = %d \n", histogram_count_[i]);
     }
 
     // Print the bin containing elements greater then the input upper
     // bound. Only print this range if the bin is not empty.
     const int max_boundary_index = boundaries_.size() - 2;
     if (histogram_count_[max_boundary_index] > 0) {
-      msg += theia::StringPrintf(
-          "> %s = %d",
-          std::to_string(boundaries_[max_boundary_index]).c_str(),
-          histogram_count_[max_boundary_index]);
+      msg += "> ";
+      AppendValue(boundaries_[max_boundary_index], &msg);
+      StringAppendF(&msg, " = %d", histogram_count_[max_boundary_index]);
     }
     return msg;
   }
 
  private:
+  // How the boundaries are spaced, which determines how a bin is found.
+  enum Spacing { kArbitrary, kUniform, kLogUniform };
+
+  // The number of values whose bin positions are computed at once by
+  // AddBatch.
+  static const int kBlockSize = 256;
+
+  // Returns the bin of the value from its position (value - origin_) *
+  // inverse_bin_width_, or its logarithmic counterpart. The position may be off
+  // by one bin due to rounding, so the bin is corrected with the boundaries.
+  int BinIndex(const T value, const double position) const {
+    const int num_interior_bins = boundaries_.size() - 3;
+    if (std::isnan(static_cast<double>(value))) {
+      return num_interior_bins + 1;
+    }
+    int bin_index;
+    if (!(position >= 0.0)) {
+      bin_index = 0;
+    } else if (position >= num_interior_bins) {
+      bin_index = num_interior_bins + 1;
+    } else {
+      bin_index = static_cast<int>(position) + 1;
+    }
+    while (bin_index > 0 && value < boundaries_[bin_index]) {
+      --bin_index;
+    }
+    while (bin_index + 1 < NumBins() && value >= boundaries_[bin_index + 1]) {
+      ++bin_index;
+    }
+    return bin_index;
+  }
+
+  // Appends the value to the string as std::to_string would print it, but
+  // without creating a temporary string.
+  static void AppendValue(const T value, std::string* str) {
+    if (std::is_floating_point<T>::value) {
+      StringAppendF(str, "%f", static_cast<double>(value));
+    } else {
+      StringAppendF(str, "%lld", static_cast<long long>(value));
+    }
+  }
+
   std::vector<T> boundaries_;
   std::vector<int> histogram_count_;
   int below_minimum_boundary_count_;
+
+  // The spacing of the boundaries and, for uniform or log-uniform boundaries,
+  // the first boundary (or its logarithm) and the inverse of the bin width.
+  Spacing spacing_;
+  double origin_;
+  double inverse_bin_width_;
 };
 
+template <typename T>
+const int Histogram<T>::kBlockSize;
+
 }  // namespace theia
 
 #endif  // THEIA_MATH_HISTOGRAM_H_
@@ -0,0 +1,99 @@
+// Please contact the author of this library if you have any questions.
+
+#ifndef THEIA_MATH_PROBABILITY_ALIAS_TABLE_H_
+#define THEIA_MATH_PROBABILITY_ALIAS_TABLE_H_
+
+#include <glog/logging.h>
+#include <random>
+#include <vector>
+
+namespace theia {
+// Walker's alias method for sampling from a discrete distribution. The table is
+// built in O(N) with Vose's algorithm and every draw afterwards is O(1): a
+// uniformly chosen column either returns its own index or its alias.
+class AliasTable {
+ public:
+  AliasTable() {}
+
+  // Builds the table for the (unnormalized, non-negative) weights. Returns
+  // false if all weights are zero.
+  template <typename T> bool Build(const std::vector<T>& weights) {
+    const int num_weights = weights.size();
+    probability_.resize(num_weights);
+    alias_.resize(num_weights);
+    small_.clear();
+    large_.clear();
+    small_.reserve(num_weights);
+    large_.reserve(num_weights);
+
+    double sum = 0.0;
+    for (const T weight : weights) {
+      CHECK_GE(weight, 0.0)
+          << "Weights of the alias table must be non-negative.";
+      sum += weight;
+    }
+    if (sum <= 0.0) {
+      return false;
+    }
+
+    // Scale the weights such that their mean is 1 and split them into the
+    // columns that are under- and overfull.
+    for (int i = 0; i < num_weights; i++) {
+      probability_[i] = weights[i] * num_weights / sum;
+      alias_[i] = i;
+      if (probability_[i] < 1.0) {
+        small_.push_back(i);
+      } else {
+        large_.push_back(i);
+      }
+    }
+
+    // Fill each underfull column with the excess of an overfull one.
+    while (!small_.empty() && !large_.empty()) {
+      const int small = small_.back();
+      const int large = large_.back();
+      small_.pop_back();
+      alias_[small] = large;
+      probability_[large] -= 1.0 - probability_[small];
+      if (probability_[large] < 1.0) {
+        large_.pop_back();
+        small_.push_back(large);
+      }
+    }
+
+    // The remaining columns are full up to rounding errors.
+    for (const int index : small_) {
+      probability_[index] = 1.0;
+    }
+    for (const int index : large_) {
+      probability_[index] = 1.0;
+    }
+    return true;
+  }
+
+  // Draws an index with probability proportional to its weight.
+  template <class RandomGenerator> int Sample(RandomGenerator* rng) const {
+    std::uniform_int_distribution<int> column_distribution(
+        0, probability_.size() - 1);
+    std::uniform_real_distribution<double> coin_distribution(0.0, 1.0);
+    const int column = column_distribution(*rng);
+    return coin_distribution(*rng) < probability_[column] ? column
+                                                           : alias_[column];
+  }
+
+  // The number of entries of the distribution.
+  int size() const { return probability_.size(); }
+
+ private:
+  // The probability of keeping each column rather than returning its alias.
+  std::vector<double> probability_;
+  std::vector<int> alias_;
+
+  // Work lists used while building the table.
+  std::vector<int> small_;
+  std::vector<int> large_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_PROBABILITY_ALIAS_TABLE_H_
@@ -0,0 +1,32 @@
+// Please contact the author of this library if you have any questions.
+
+#ifndef THEIA_MATH_PROBABILITY_GAMMA_DISTRIBUTION_H_
+#define THEIA_MATH_PROBABILITY_GAMMA_DISTRIBUTION_H_
+
+#include <vector>
+
+namespace theia {
+// The regularized lower incomplete gamma function P(a, x) = gamma(a, x) /
+// Gamma(a) for a > 0 and x >= 0.
+double RegularizedLowerIncompleteGamma(const double a, const double x);
+
+// The regularized upper incomplete gamma function Q(a, x) = 1 - P(a, x).
+double RegularizedUpperIncompleteGamma(const double a, const double x);
+
+// The probability density function of the gamma distribution with shape k and
+// scale theta.
+double GammaPdf(const double x, const double k, const double theta);
+
+// The cumulative distribution function of the gamma distribution with shape k
+// and scale theta.
+double GammaCdf(const double x, const double k, const double theta);
+
+// Estimates the shape k and scale theta of a gamma distribution from the
+// samples by maximum likelihood, using the generalized Newton iterations of
+// "Estimating a Gamma distribution" by T. Minka. All samples must be positive.
+// Returns false if the parameters could not be estimated.
+bool FitGamma(const std::vector<double>& samples, double* k, double* theta);
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_PROBABILITY_GAMMA_DISTRIBUTION_H_
@@ -0,0 +1,54 @@
+// Please contact the author of this library if you have any questions.
+
+#ifndef THEIA_MATH_PROBABILITY_GEV_DISTRIBUTION_H_
+#define THEIA_MATH_PROBABILITY_GEV_DISTRIBUTION_H_
+
+#include <vector>
+
+namespace theia {
+// The generalized extreme value (GEV) distribution with location mu, scale
+// sigma and shape (tail) xi. Its cumulative distribution function is
+//
+//   F(x) = exp(-(1 + xi * (x - mu) / sigma)^(-1 / xi))
+//
+// for 1 + xi * (x - mu) / sigma > 0, and exp(-exp(-(x - mu) / sigma)) when xi
+// is zero (the Gumbel distribution).
+
+// The probability density function of the GEV distribution.
+double GevPdf(const double x,
+              const double mu,
+              const double sigma,
+              const double xi);
+
+// The cumulative distribution function of the GEV distribution.
+double GevCdf(const double x,
+              const double mu,
+              const double sigma,
+              const double xi);
+
+// Method used to estimate the GEV parameters.
+//   PROBABILITY_WEIGHTED_MOMENTS: The closed form estimator of "Estimation of
+//     the Generalized Extreme-Value Distribution by the Method of
+//     Probability-Weighted Moments" by Hosking, Wallis and Wood.
+//   MAXIMUM_LIKELIHOOD: Maximizes the likelihood of the samples.
+//   QUANTILE_LEAST_SQUARES: Minimizes the squared difference between the
+//     sample quantiles and the quantiles of the distribution.
+// The iterative estimators start from the probability weighted moments
+// estimate and are minimized with the Nelder-Mead simplex method.
+enum GevFittingMethod {
+  PROBABILITY_WEIGHTED_MOMENTS = 0,
+  MAXIMUM_LIKELIHOOD = 1,
+  QUANTILE_LEAST_SQUARES = 2
+};
+
+// Estimates the parameters of a GEV distribution from the samples. Returns
+// false if the parameters could not be estimated.
+bool FitGev(const std::vector<double>& samples,
+            const GevFittingMethod fitting_method,
+            double* mu,
+            double* sigma,
+            double* xi);
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_PROBABILITY_GEV_DISTRIBUTION_H_
@@ -0,0 +1,113 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_AC_RANSAC_H_
+#define THEIA_SOLVERS_AC_RANSAC_H_
+
+#include <math.h>
+#include <limits>
+#include <vector>
+
+#include "theia/solvers/estimator.h"
+#include "theia/solvers/nfa_quality_measurement.h"
+#include "theia/solvers/random_sampler.h"
+#include "theia/solvers/sample_consensus_estimator.h"
+
+namespace theia {
+// Estimate a model using AC-RANSAC (also known as ORSA) from "A contrario
+// methodology for robust estimation" by Moisan, Moulon and Monasse. Instead of
+// using a fixed inlier threshold, the threshold of each model is chosen to
+// minimize its Number of False Alarms (see nfa_quality_measurement.h), and the
+// model with the smallest NFA is kept. RansacParameters::error_thresh is only
+// the maximum threshold considered.
+//
+// Estimate returns false if no meaningful model (i.e. with an NFA below 1) was
+// found. Otherwise, the inliers of the summary are those below the threshold
+// selected for the best model, which is returned by InlierThreshold().
+template <class ModelEstimator>
+class AcRansac : public SampleConsensusEstimator<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+
+  // Params:
+  //   alpha0:  The probability per unit of residual that a random datum is an
+  //     inlier, e.g. pi / A for squared reprojection errors in an image of area
+  //     A (in the units of the residuals).
+  //   num_models_per_sample:  The maximum number of models the estimator
+  //     returns for a minimal sample.
+  AcRansac(const RansacParameters& ransac_params,
+           const ModelEstimator& estimator,
+           const double alpha0,
+           const int num_models_per_sample = 1)
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator),
+        alpha0_(alpha0),
+        num_models_per_sample_(num_models_per_sample),
+        nfa_quality_measurement_(nullptr),
+        inlier_threshold_(ransac_params.error_thresh) {}
+  ~AcRansac() {}
+
+  // Initializes the random sampler and the NFA quality measurement.
+  bool Initialize() {
+    Sampler<Datum>* random_sampler =
+        new RandomSampler<Datum>(this->estimator_.SampleSize());
+    if (!SampleConsensusEstimator<ModelEstimator>::Initialize(random_sampler)) {
+      return false;
+    }
+    nfa_quality_measurement_ = new NfaQualityMeasurement(
+        this->ransac_params_.error_thresh, this->estimator_.SampleSize(),
+        alpha0_, num_models_per_sample_);
+    this->quality_measurement_.reset(nfa_quality_measurement_);
+    return nfa_quality_measurement_->Initialize();
+  }
+
+  bool Estimate(const std::vector<Datum>& data,
+                Model* best_model,
+                RansacSummary* summary) {
+    CHECK_NOTNULL(nfa_quality_measurement_)->Initialize();
+    if (!SampleConsensusEstimator<ModelEstimator>::Estimate(data, best_model,
+                                                            summary)) {
+      return false;
+    }
+
+    // Recover the threshold selected for the best model from its residuals.
+    const double log_nfa =
+        summary->residuals.empty()
+            ? std::numeric_limits<double>::max()
+            : nfa_quality_measurement_->ComputeCost(summary->residuals);
+    VLOG(2) << "Best model has log(NFA) = " << log_nfa << " at threshold "
+            << nfa_quality_measurement_->threshold();
+    if (log_nfa >= 0.0) {
+      summary->inliers.clear();
+      summary->inlier_mask.clear();
+      summary->confidence = 0.0;
+      return false;
+    }
+
+    inlier_threshold_ = nfa_quality_measurement_->threshold();
+    this->SetInliersFromResiduals(inlier_threshold_, summary);
+    const double inlier_ratio =
+        static_cast<double>(summary->inliers.size()) / data.size();
+    summary->confidence =
+        1.0 - pow(1.0 - pow(inlier_ratio, this->estimator_.SampleSize()),
+                  summary->num_iterations);
+    return true;
+  }
+
+  // The threshold selected for the model returned by the last call to
+  // Estimate.
+  double InlierThreshold() const { return inlier_threshold_; }
+
+ private:
+  const double alpha0_;
+  const int num_models_per_sample_;
+
+  // The quality measurement set up in Initialize. Owned by the base class.
+  NfaQualityMeasurement* nfa_quality_measurement_;
+
+  double inlier_threshold_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_AC_RANSAC_H_
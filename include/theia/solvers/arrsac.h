@@ -140,7 +140,7 @@ int Arrsac<ModelEstimator>::GenerateInitialHypothesisSet(
   random_sampler.Initialize();
   prosac_sampler.Initialize();
 
-  while (k <= m_prime) {
+  while (k <= m_prime && !this->Cancelled()) {
     std::vector<Model> hypotheses;
     if (!inner_ransac) {
       // Generate hypothesis h(k) with k-th PROSAC sample.
@@ -166,8 +166,8 @@ int Arrsac<ModelEstimator>::GenerateInitialHypothesisSet(
       int num_tested_points;
       double observed_inlier_ratio;
       // Evaluate hypothesis h(k) with SPRT.
-      std::vector<double> residuals =
-          this->estimator_.Residuals(data_input, hypothesis);
+      std::vector<double>& residuals = this->workspace_.residuals;
+      this->estimator_.ComputeResiduals(data_input, hypothesis, &residuals);
       bool sprt_test = SequentialProbabilityRatioTest(
           residuals, this->ransac_params_.error_thresh, sigma_, epsilon_,
           decision_threshold, &num_tested_points, &observed_inlier_ratio);
@@ -206,6 +206,11 @@ int Arrsac<ModelEstimator>::GenerateInitialHypothesisSet(
         // Estimate epsilon as inlier ratio for largest size of support.
         epsilon_ = static_cast<double>(max_num_inliers) /
                    static_cast<double>(data_input.size());
+        this->ReportProgress(
+            hypothesis, observed_inlier_ratio,
+            1.0 - pow(1.0 - pow(observed_inlier_ratio,
+                                this->estimator_.SampleSize()),
+                      k));
         // estimate inlier ratio e' and M_prime (eq 1) Cap M_prime at max of M
         // TODO(cmsweeney): verify that num_tested_points is the correct value
         // here and not data_input.size().
@@ -245,6 +250,10 @@ bool Arrsac<ModelEstimator>::Estimate(const std::vector<Datum>& data,
 
   // Preemptive Evaluation
   for (int i = block_size_ + 1; i < data.size(); i++) {
+    if (this->Cancelled()) {
+      break;
+    }
+
     // Select n, the number of hypotheses to consider.
     int f_i =
         floor(max_candidate_hyps_ * pow(2, -1.0 * floor(i / block_size_)));
@@ -316,6 +325,7 @@ bool Arrsac<ModelEstimator>::Estimate(const std::vector<Datum>& data,
     }
   }
 
+  summary->cancelled = this->Cancelled();
   if (hypotheses.size() > 0) {
     // The best model should be at the beginning of the list since we only quit
     // when n==1.
@@ -325,15 +335,20 @@ bool Arrsac<ModelEstimator>::Estimate(const std::vector<Datum>& data,
   }
 
   // Grab inliers to refine the model.
-  summary->inliers = this->estimator_
-      .GetInliers(data, *best_model, this->ransac_params_.error_thresh);
+  this->estimator_.ComputeResiduals(data, *best_model, &summary->residuals);
+  this->SetInliersFromResiduals(this->ransac_params_.error_thresh, summary);
   const double inlier_ratio =
       static_cast<double>(summary->inliers.size()) / data.size();
   summary->confidence =
       1.0 - pow(1.0 - pow(inlier_ratio, this->estimator_.SampleSize()),
                 summary->num_iterations);
+  // The preemptive evaluation may have selected a different hypothesis than
+  // the best one of the initial set, so the final model is reported as well.
+  this->ReportProgress(
+      *best_model, inlier_ratio,
+      1.0 - pow(1.0 - pow(inlier_ratio, this->estimator_.SampleSize()), k));
 
-  return true;
+  return !summary->cancelled;
 }
 
 }  // namespace theia
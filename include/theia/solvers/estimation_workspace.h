@@ -0,0 +1,40 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_ESTIMATION_WORKSPACE_H_
+#define THEIA_SOLVERS_ESTIMATION_WORKSPACE_H_
+
+#include <vector>
+
+#include "theia/math/combination_enumerator.h"
+
+namespace theia {
+// Scratch buffers used by the sample consensus estimators while estimating a
+// model. A workspace is owned by each SampleConsensusEstimator and is reused
+// across iterations and across calls to Estimate, so once the buffers have
+// grown to the largest dataset seen no further memory is allocated. The
+// buffers only ever grow; they are never shrunk.
+template <class Datum, class Model> struct EstimationWorkspace {
+  // Grows the buffers so that a dataset of num_data points and minimal samples
+  // of sample_size points can be processed without reallocation.
+  void Reserve(const int num_data, const int sample_size) {
+    data_subset.reserve(sample_size);
+    residuals.reserve(num_data);
+  }
+
+  // The minimal sample drawn by the sampler.
+  std::vector<Datum> data_subset;
+
+  // The models estimated from data_subset.
+  std::vector<Model> models;
+
+  // The residuals of all data points w.r.t. the model currently being scored.
+  std::vector<double> residuals;
+
+  // The enumeration of the minimal samples during exhaustive enumeration.
+  CombinationEnumerator combinations;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_ESTIMATION_WORKSPACE_H_
@@ -19,6 +19,12 @@ namespace theia {
 //
 // NOTE: RANSAC, ARRSAC, and other solvers work best if Datum and Model are
 // lightweight classes or structs.
+//
+// NOTE: Every call made through this interface is a virtual call, including the
+// per-point Error() calls made while scoring hypotheses. Estimators used in
+// performance critical loops should derive from StaticEstimator (see
+// static_estimator.h) instead, which has the same interface but is dispatched
+// at compile time.
 
 template <typename DatumType, typename ModelType> class Estimator {
  public:
@@ -31,6 +37,20 @@ template <typename DatumType, typename ModelType> class Estimator {
   // Get the minimum number of samples needed to generate a model.
   virtual double SampleSize() const = 0;
 
+  // Enable a quick check to see if the sample is valid before a model is
+  // estimated from it, e.g. to reject degenerate configurations for which the
+  // solver is ill-conditioned. This is called for every sample, so it should
+  // only cost a few operations.
+  virtual bool ValidSample(const std::vector<Datum>& sample) const {
+    return true;
+  }
+
+  // Returns true if the models estimated from a sample depend on the order of
+  // its data points, e.g. if the last point of a sample is used differently
+  // from the others. The sample cache (see RansacParameters::use_sample_cache)
+  // then only skips samples of the same data points in the same order.
+  virtual bool SampleOrderMatters() const { return false; }
+
   // Given a set of data points, estimate the model. Users should implement this
   // function appropriately for the task being solved. Returns true for
   // successful model estimation (and outputs model), false for failed
@@ -71,24 +91,56 @@ template <typename DatumType, typename ModelType> class Estimator {
     return residuals;
   }
 
+  // Compute the residuals of many data points into the output vector. This is
+  // the method called by the sample consensus estimators. By default it
+  // forwards to Residuals, so that estimators which override Residuals keep
+  // working, but a new vector is then returned for every model. Override it
+  // to compute the residuals into the storage of the output vector, which the
+  // sample consensus estimators reuse across models and calls to Estimate.
+  virtual void ComputeResiduals(const std::vector<Datum>& data,
+                                const Model& model,
+                                std::vector<double>* residuals) const {
+    *residuals = Residuals(data, model);
+  }
+
   // Returns the set inliers of the data set based on the error threshold
   // provided.
   std::vector<int> GetInliers(const std::vector<Datum>& data,
                               const Model& model,
                               double error_threshold) const {
     std::vector<int> inliers;
-    inliers.reserve(data.size());
+    GetInliers(data, model, error_threshold, &inliers);
+    return inliers;
+  }
+
+  // Same as above, but the inliers are written to the output vector so that its
+  // storage may be reused.
+  void GetInliers(const std::vector<Datum>& data,
+                  const Model& model,
+                  double error_threshold,
+                  std::vector<int>* inliers) const {
+    inliers->clear();
+    inliers->reserve(data.size());
     for (int i = 0; i < data.size(); i++) {
       if (Error(data[i], model) < error_threshold) {
-        inliers.push_back(i);
+        inliers->push_back(i);
       }
     }
-    return inliers;
   }
 
   // Enable a quick check to see if the model is valid. This can be a geometric
   // check or some other verification of the model structure.
   virtual bool ValidModel(const Model& model) const { return true; }
+
+  // Enable a quick check of a model against the sample it was estimated from,
+  // e.g. that the sample is reprojected in front of the camera. This is called
+  // for every model before it is scored on all of the data. error_thresh is the
+  // inlier threshold of the sample consensus estimator.
+  virtual bool ValidModelForSample(const std::vector<Datum>& sample,
+                                   const Model& model,
+                                   const double error_thresh) const {
+    return true;
+  }
 };
 
 }  // namespace theia
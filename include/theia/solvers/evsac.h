@@ -4,11 +4,12 @@
 #ifndef THEIA_SOLVERS_EVSAC_H_
 #define THEIA_SOLVERS_EVSAC_H_
 
-#include <statx/distributions/evd/common.h>
+#include <Eigen/Core>
 
 #include "theia/solvers/estimator.h"
 #include "theia/solvers/evsac_sampler.h"
 #include "theia/solvers/sample_consensus_estimator.h"
+#include "theia/util/util.h"
 
 namespace theia {
 // Estimate a model using EVSAC sampler.
@@ -23,7 +24,8 @@ class Evsac : public SampleConsensusEstimator<ModelEstimator> {
   //   matrix has num. of query features as rows and k columns.
   // predictor_threshold:  The threshold used to decide correct or
   //   incorrect matches/correspondences. The recommended value is 0.65.
-  // fitting_method:  The fiting method MLE or QUANTILE_NLS (see statx doc).
+  // fitting_method:  The fitting method MLE or QUANTILE_NLS of the GEV
+  //   distribution (see gev_distribution.h).
   //   The recommended fitting method is the MLE estimation.
   Evsac(const RansacParameters& ransac_params,
         const ModelEstimator& estimator,
@@ -5,19 +5,20 @@
 #define THEIA_SOLVERS_EVSAC_SAMPLER_H_
 
 #include <Eigen/Core>
+#ifdef THEIA_USE_OPENMP
+#include <omp.h>
+#endif
 #include <glog/logging.h>
-#include <optimo/solvers/primal_dual_qp.h>
-#include <statx/distributions/evd/gev.h>
-#include <statx/distributions/gamma.h>
-#include <statx/distributions/rayleigh.h>
-#include <statx/utils/ecdf.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
-#include <memory>
 #include <random>
 #include <vector>
 
+#include "theia/math/probability/alias_table.h"
+#include "theia/math/probability/gamma_distribution.h"
+#include "theia/math/probability/gev_distribution.h"
 #include "theia/solvers/sampler.h"
 #include "theia/util/util.h"
 
@@ -40,6 +41,11 @@ enum FittingMethod {MLE = 0, QUANTILE_NLS = 1};
 // distribution. EVSAC tries to find the parameters for these two distributions
 // as well as to estimate the mixing parameter, which happens to be an estimate
 // of the inlier ratio.
+//
+// The correspondences are drawn from the resulting weights with an alias table
+// that is built once in Initialize, so that every draw is O(1). The
+// Meta-Recognition predictions of the rows are computed in parallel when
+// OpenMP is enabled.
 template <class Datum> class EvsacSampler : public Sampler<Datum> {
  public:
   // Params:
@@ -89,18 +95,21 @@ template <class Datum> class EvsacSampler : public Sampler<Datum> {
   //   the data.
   // predictor_threshold:  Confidence threshold to declare a correspondence as
   //   correct one. This confidence is within the interval of 0 and 1.
-  static inline bool MRRayleigh(const Eigen::RowVectorXd& sorted_distances,
-                                const double predictor_threshold) {
+  static inline bool MRRayleigh(
+      const Eigen::Ref<const Eigen::RowVectorXd, 0, Eigen::InnerStride<> >&
+          sorted_distances,
+      const double predictor_threshold) {
     CHECK_GT(predictor_threshold, 0.0);
     CHECK_LE(predictor_threshold, 1.0);
-    const std::vector<double> tail(
-        sorted_distances.data() + 1,
-        sorted_distances.data() + sorted_distances.size());
-    // Fit distribution tail!
-    const double sigma = statx::distributions::raylfit(tail);
-    // Calculate belief of correctness.
+    // Fit distribution tail! The maximum likelihood estimate of the Rayleigh
+    // scale is sigma^2 = sum(x^2) / (2 * n).
+    const int tail_size = sorted_distances.size() - 1;
+    const double two_sigma_sq =
+        sorted_distances.tail(tail_size).squaredNorm() / tail_size;
+    // Calculate belief of correctness, i.e. one minus the Rayleigh cdf of the
+    // smallest distance.
     const double confidence =
-        1.0 - statx::distributions::raylcdf(sorted_distances[0], sigma);
+        std::exp(-sorted_distances[0] * sorted_distances[0] / two_sigma_sq);
     return confidence >= predictor_threshold;
   }
 
@@ -126,8 +135,9 @@ template <class Datum> class EvsacSampler : public Sampler<Datum> {
   //   matrix has num. of query features as rows and k columns.
   // predictor_threshold:  The threshold used to decide correct or
   //   incorrect matches/correspondences. The recommended value is 0.65.
-  // fitting_method:  The fitting method MLE or QUANTILE_NLS (see statx doc).
-  //   The recommended fitting method is the MLE estimation.
+  // fitting_method:  The fitting method MLE or QUANTILE_NLS of the GEV
+  //   distribution (see gev_distribution.h). The recommended fitting method is
+  //   the MLE estimation.
   // mixture_parameters:  The parameters of the pixture model.
   // probabilities:  The computed probabilities for every correspondence using
   //   the estimated mixture model.
@@ -155,7 +165,7 @@ template <class Datum> class EvsacSampler : public Sampler<Datum> {
   // Fitting method.
   FittingMethod fitting_method_;
   // Correspondence sampler following the computed probabilities.
-  std::unique_ptr<std::discrete_distribution<>> correspondence_sampler;
+  AliasTable correspondence_sampler_;
   // RNG
   std::mt19937 rng_;
   // Mixture Model Params.
@@ -221,24 +231,26 @@ template <class Datum> class EvsacSampler : public Sampler<Datum> {
   // [0 0]' <= x <= [inlier_ratio_upper_bound 1]',
   //
   // where x = [inlier_ratio (1 - inlier_ratio)]'; which is our vector of
-  // unknowns.
-  // This LS problem can be transformed into a QP problem:
+  // unknowns, y is the empirical cdf of the smallest distances, and the columns
+  // of A are the cdfs of the gamma and (reversed) GEV distributions evaluated
+  // at the support of the empirical cdf:
   //
-  // minimize_x 0.5 * x' * A' * A * x - 2 * y' * A * x + y' * y
-  //
-  // subject to
+  // A(:, 0) = gammacdf(empirical_cdf_support; gamma_parameters)
+  // A(:, 1) = 1 - gevcdf(-empirical_cdf_support; gev_parameters).
   //
-  // [1 1] * x = 1
-  // [0 0]' <= x <= [inlier_ratio_upper_bound 1]'.
+  // The problem finds the best inlier ratio such that the difference between
+  // the empirical cdf of the smallest distances and the cdf obtained by our
+  // mixture model (gamma + GEV) is minimal and that is less than the upper
+  // bound estimated from the predictions. Substituting the equality constraint
+  // leaves a one dimensional quadratic in the inlier ratio over an interval,
+  // whose minimizer is the clamped unconstrained minimizer:
   //
-  // This quadratic program finds the best inlier ratio such that the difference
-  // between the empirical cdf of the smallest distances and the cdf obtained by
-  // our mixture model (gamma + GEV) is minimal and that is less than the upper
-  // bound estimated from the predictions.
+  // inlier_ratio = clamp((a0 - a1)' * (y - a1) / norm(a0 - a1)^2,
+  //                      0, inlier_ratio_upper_bound).
   //
   // Params:
   //   inlier_ratio_upper_bound:  The upper bound for estimating the inlier
-  //     ratio by solving the proposed QP problem.
+  //     ratio.
   //   smallest_distances:  The smallest distances when matching.
   //   mixture_model_params:  The compute parameters for the gamma and GEV
   //     distributions.
@@ -264,172 +276,49 @@ template <class Datum> class EvsacSampler : public Sampler<Datum> {
       const std::vector<bool>& predictions,
       std::vector<float>* probabilities);
 
-  typedef optimo::solvers::PrimalDualQP<
-    double,
-    2 /* Num. Unknowns */,
-    4 /* Num. Inequalities */,
-    1 /* Num. Equalities */ > PrimalDualQP;
-
-  // Sets the inequality constraints.
-  // The matrix Ain considers the case that inlier_ratio and (1 - inlier_ratio)
-  // must be positive. Moreover, we set in this matrix the upperbound
-  // constraints. The inequality constraints can be written in matrix form as
-  // follows:
-  // | -1  0 |                           |             0            |
-  // |  0 -1 | |  inlier_ratio    |  <=  |             0            |
-  // |  1  0 | | 1 - inlier_ratio |      | inlier_ratio_upper_bound |
-  // |  0  1 |                           |             1            |
-  //
-  //    Ain           x              <=               bin.
-  //
-  // Params:
-  //   inlier_ratio_upper_bound:  The upper bound for estimating the inlier
-  //     ratio by solving the proposed QP problem.
-  //   qp_params:  The QP params where the inequality constraints will be set.
-  static inline void SetInequalityConstraints(
-      const double inlier_ratio_upper_bound,  PrimalDualQP::Params* qp_params);
-
-  // Sets the equality constraints.
-  // The matrix Aeq considers the case that the vector of unknowns, x, must sum
-  // up to 1:
-  // | 1  1 | |   inlier_ratio   | = [ 1 ]
-  //          | 1 - inlier_ratio |
-  //   Aeq            x            =  beq.
-  //
-  // Params:
-  //   qp_params:  The QP params where the equality constraints will be set.
-  static inline
-  void SetEqualityConstraints(PrimalDualQP::Params* qp_params);
-
-  // Building the quadratic cost function for the QP:
-  //
-  // J(x) = x' * Q * x + d' * x,
-  //
-  // where
-  // Q = A' * A, and d = A ' * empirical_cdf.
-  // Matrix A is formed as follows:
-  //
-  // A(:, 0) = gammacdf(empirical_cdf_support; gamma_parameters)
-  // A(:, 1) = 1 - gev(empirical_cdf_support; gev_parameters),
-  //
-  // where A(:, i) means the (i + 1)-th column, and the empirical_cdf_support is
-  // the support of the empirical distribution function of the smallest
-  // distances. Note that we set the second column to the reversed GEV; this is
-  // done because we are considering minimums from the random process that
-  // generates distances for incorrect correspondences.
-  //
-  // Params:
-  //   smallest_distances:  The smallest distances when matching.
-  //   qp_params:  The QP params where the equality constraints will be set.
-  static void SetQPCostFunctionParams(
-      const std::vector<double>& smallest_distances,
-      const MixtureModelParams& mixture_model_params,
-      PrimalDualQP::Params* qp_params);
-
-  // Solves the QP problem to estimate the inlier ratio.
-  // Params:
-  //   inlier_ratio_upper_bound:  The inlier ratio upper bound estimated from
-  //     predictions.
-  //   qp_params:  The QP parameters that define the problem to solve.
-  //   mixture_model_params:  Structure that holds the estimated inlier ratio.
-  static inline
-  bool SolveQPProblem(
-      const double inlier_ratio_upper_bound,
-      const PrimalDualQP::Params& qp_params,
-      MixtureModelParams* mixture_model_params);
-
   DISALLOW_COPY_AND_ASSIGN(EvsacSampler);
 };
 
 // -------------------------- Implementation -------------------------------
-template <class Datum>
-bool EvsacSampler<Datum>::SolveQPProblem(
-    const double inlier_ratio_upper_bound,
-    const PrimalDualQP::Params& qp_params,
-    MixtureModelParams* mixture_model_params) {
-  Eigen::Vector2d unknowns_vector;
-  // Setting initial point, i.e., guessed solution.
-  unknowns_vector(0) = inlier_ratio_upper_bound / 2.0;
-  unknowns_vector(1) = 1 - unknowns_vector(0);
-  PrimalDualQP qp_solver;
-  qp_solver.options.max_iter_ = 100;
-  double min_value;
-  const optimo::solvers::TERMINATION_TYPE termination_type =
-      qp_solver(qp_params, &unknowns_vector, &min_value);
-  VLOG(2) << "estimated inlier ratio=" << unknowns_vector(0)
-          << " termination_type: " << termination_type;
-  mixture_model_params->inlier_ratio = unknowns_vector(0);
-  return termination_type == optimo::solvers::SOLVED;
-}
-
-template <class Datum>
-void EvsacSampler<Datum>::SetQPCostFunctionParams(
-    const std::vector<double>& smallest_distances,
-    const MixtureModelParams& mixture_model_params,
-    PrimalDualQP::Params* qp_params) {
-  std::vector<double> empirical_cdf_vector;
-  std::vector<double> empirical_cdf_support;
-  statx::utils::ecdf(
-      smallest_distances, &empirical_cdf_vector, &empirical_cdf_support);
-  Eigen::Map<Eigen::VectorXd> empirical_cdf(
-      &empirical_cdf_vector[0], empirical_cdf_vector.size());
-
-  // Calculate matrix A.
-  Eigen::MatrixXd A(empirical_cdf_support.size(), 2);
-
-  for (int i = 0; i < empirical_cdf_support.size(); i++) {
-    A(i, 0) = statx::distributions::gammacdf(
-        empirical_cdf_support[i], mixture_model_params.k,
-        mixture_model_params.theta);
-    A(i, 1) = 1.0 - statx::distributions::evd::gevcdf(
-        -empirical_cdf_support[i], mixture_model_params.mu,
-        mixture_model_params.sigma, mixture_model_params.xi);
-  }
-  CHECK_NOTNULL(qp_params)->Q = A.transpose() * A;
-  qp_params->d = -1.0 * A.transpose() * empirical_cdf;
-}
-
-template <class Datum>
-void EvsacSampler<Datum>::SetEqualityConstraints(
-    PrimalDualQP::Params* qp_params) {
-  CHECK_NOTNULL(qp_params)->Aeq.setConstant(1.0);
-  qp_params->beq(0, 0) = 1.0;
-}
-
-template <class Datum>
-void EvsacSampler<Datum>::SetInequalityConstraints(
-    const double inlier_ratio_upper_bound, PrimalDualQP::Params* qp_params) {
-  CHECK_NOTNULL(qp_params)->Ain.setConstant(0.0);
-  qp_params->Ain(0, 0) = -1.0;
-  qp_params->Ain(1, 1) = -1.0;
-  qp_params->Ain(2, 0) = 1.0;
-  qp_params->Ain(3, 1) = 1.0;
-
-  qp_params->bin.setConstant(0.0);
-  qp_params->bin(2) = inlier_ratio_upper_bound;
-  qp_params->bin(3) = 1.0;
-}
-
 template <class Datum>
 bool EvsacSampler<Datum>::EstimateInlierRatio(
     const double inlier_ratio_upper_bound,
     const std::vector<double>& smallest_distances,
     MixtureModelParams* mixture_model_params) {
-  PrimalDualQP::Params qp_params;
-
-  // Set inequality constraints.
-  SetInequalityConstraints(inlier_ratio_upper_bound, &qp_params);
-
-  // Comppute equality constraints.
-  SetEqualityConstraints(&qp_params);
-
-  // Set the bulding QP params.
-  SetQPCostFunctionParams(
-      smallest_distances, *mixture_model_params, &qp_params);
+  CHECK_NOTNULL(mixture_model_params);
+  std::vector<double> sorted_distances(smallest_distances);
+  std::sort(sorted_distances.begin(), sorted_distances.end());
+
+  // Accumulate the normal equation of the one dimensional LS problem over the
+  // support of the empirical cdf, i.e. the unique smallest distances.
+  double numerator = 0.0;
+  double denominator = 0.0;
+  const int num_distances = sorted_distances.size();
+  for (int i = 0; i < num_distances; i++) {
+    if (i + 1 < num_distances &&
+        sorted_distances[i + 1] == sorted_distances[i]) {
+      continue;
+    }
+    const double empirical_cdf = (i + 1.0) / num_distances;
+    const double gamma_cdf =
+        GammaCdf(sorted_distances[i], mixture_model_params->k,
+                 mixture_model_params->theta);
+    const double reversed_gev_cdf =
+        1.0 - GevCdf(-sorted_distances[i], mixture_model_params->mu,
+                     mixture_model_params->sigma, mixture_model_params->xi);
+    const double difference = gamma_cdf - reversed_gev_cdf;
+    numerator += difference * (empirical_cdf - reversed_gev_cdf);
+    denominator += difference * difference;
+  }
 
-  // Solve the QP.
-  return SolveQPProblem(
-      inlier_ratio_upper_bound, qp_params, mixture_model_params);
+  if (!(denominator > 0.0)) {
+    VLOG(2) << "The gamma and GEV distributions cannot be distinguished.";
+    return false;
+  }
+  mixture_model_params->inlier_ratio = std::max(
+      0.0, std::min(numerator / denominator, inlier_ratio_upper_bound));
+  VLOG(2) << "estimated inlier ratio=" << mixture_model_params->inlier_ratio;
+  return true;
 }
 
 template <class Datum>
@@ -443,15 +332,17 @@ void EvsacSampler<Datum>::ComputePosteriorAndWeights(
   for (int i = 0; i < num_correspondences; i++) {
     // Calculate posterior.
     const double gam_val =
-        mixture_model_params.inlier_ratio * statx::distributions::gammapdf(
-            smallest_distances[i], mixture_model_params.k,
-            mixture_model_params.theta);
+        mixture_model_params.inlier_ratio *
+        GammaPdf(smallest_distances[i], mixture_model_params.k,
+                 mixture_model_params.theta);
+    // The GEV distribution is fit to the negated distances of the incorrect
+    // matches, so it is evaluated at the negated distance.
     const double gev_val =
         (1.0 - mixture_model_params.inlier_ratio) *
-        statx::distributions::evd::gevpdf(
-            smallest_distances[i], mixture_model_params.mu,
-            mixture_model_params.sigma, mixture_model_params.xi);
-    const double posterior = gam_val / (gam_val + gev_val);
+        GevPdf(-smallest_distances[i], mixture_model_params.mu,
+               mixture_model_params.sigma, mixture_model_params.xi);
+    const double posterior =
+        gam_val + gev_val > 0.0 ? gam_val / (gam_val + gev_val) : 0.0;
     // Removing those matches that are likely to be incorrect.
     (*probabilities)[i] = predictions[i] ? static_cast<float>(posterior) : 0.0f;
   }
@@ -461,7 +352,7 @@ template <class Datum>
 bool EvsacSampler<Datum>::FitGamma(
     const std::vector<double>& predicted_correct_correspondences_distances,
     MixtureModelParams* mixture_model_parameters) {
-  const bool gam_success = statx::distributions::gammafit(
+  const bool gam_success = theia::FitGamma(
       predicted_correct_correspondences_distances,
       &CHECK_NOTNULL(mixture_model_parameters)->k,
       &mixture_model_parameters->theta);
@@ -476,14 +367,12 @@ bool EvsacSampler<Datum>::FitGEV(
     const FittingMethod fitting_method,
     const std::vector<double>& negated_second_smallest_distances,
     MixtureModelParams* mixture_model_parameters) {
-  const statx::distributions::evd::FitType fitting_type =
-      (fitting_method == MLE) ?
-      statx::distributions::evd::MLE : statx::distributions::evd::QUANTILE_NLS;
-  const bool gev_success = gevfit(
-      negated_second_smallest_distances,
+  const GevFittingMethod fitting_type =
+      (fitting_method == MLE) ? MAXIMUM_LIKELIHOOD : QUANTILE_LEAST_SQUARES;
+  const bool gev_success = theia::FitGev(
+      negated_second_smallest_distances, fitting_type,
       &CHECK_NOTNULL(mixture_model_parameters)->mu,
-      &mixture_model_parameters->sigma, &mixture_model_parameters->xi,
-      fitting_type);
+      &mixture_model_parameters->sigma, &mixture_model_parameters->xi);
   VLOG(2) << "GEV distribution: mu=" << mixture_model_parameters->mu
           << " sigma=" << mixture_model_parameters->sigma
           << " xi=" << mixture_model_parameters->xi << " flag: " << gev_success;
@@ -505,6 +394,15 @@ double EvsacSampler<Datum>::ExtractDataForFittingDistributions(
   CHECK_NOTNULL(smallest_distances)->resize(sorted_distances.rows());
   CHECK_NOTNULL(negated_second_smallest_distances)->resize(
       sorted_distances.rows());
+  // The tail fits of the rows are independent of each other. The predictions
+  // are gathered in a temporary vector since concurrent writes to a
+  // std::vector<bool> are not thread safe.
+  std::vector<char> predictions(sorted_distances.rows());
+#pragma omp parallel for
+  for (int i = 0; i < sorted_distances.rows(); ++i) {
+    predictions[i] = MRRayleigh(sorted_distances.row(i), predictor_threshold);
+  }
+
   double estimated_inlier_ratio = 0.0;
   for (int i = 0; i < sorted_distances.rows(); ++i) {
     // Copying the first column from sorted distances to estimate the parameters
@@ -514,8 +412,7 @@ double EvsacSampler<Datum>::ExtractDataForFittingDistributions(
     // estimate the parameters of the reversed GEV distribution.
     (*negated_second_smallest_distances)[i] = -sorted_distances(i, 1);
     // Saving the predictions.
-    (*predicted_correct_correspondences)[i] =
-        MRRayleigh(sorted_distances.row(i), predictor_threshold);
+    (*predicted_correct_correspondences)[i] = predictions[i] != 0;
     if ((*predicted_correct_correspondences)[i]) {
       predicted_correct_correspondences_distances->push_back(
           sorted_distances(i, 0));
@@ -596,11 +493,18 @@ bool EvsacSampler<Datum>::Initialize() {
     return false;
   }
 
-  // Initialize sampler.
-  correspondence_sampler.reset(new std::discrete_distribution<>(
-      probabilities.begin(), probabilities.end()));
+  // A sample needs at least min_num_samples correspondences that can be drawn.
+  const int num_drawable = std::count_if(
+      probabilities.begin(), probabilities.end(),
+      [](const float probability) { return probability > 0.0f; });
+  if (num_drawable < this->min_num_samples_) {
+    VLOG(2) << "Too few correspondences are predicted as correct.";
+    return false;
+  }
 
-  return true;
+  // Initialize sampler.
+  this->sample_indices_.resize(this->min_num_samples_);
+  return correspondence_sampler_.Build(probabilities);
 }
 
 template <class Datum>
@@ -608,16 +512,16 @@ bool EvsacSampler<Datum>::Sample(const std::vector<Datum>& data,
                                  std::vector<Datum>* subset) {
   CHECK_EQ(data.size(), sorted_distances_.rows());
   CHECK_NOTNULL(subset)->resize(this->min_num_samples_);
-  std::vector<int> random_numbers;
   for (int i = 0; i < this->min_num_samples_; i++) {
     int rand_number;
     // Generate a random number that has not already been used.
-    while (std::find(random_numbers.begin(), random_numbers.end(),
-                     (rand_number = (*correspondence_sampler)(rng_)))
-           != random_numbers.end()) {}
+    while (std::find(this->sample_indices_.begin(),
+                     this->sample_indices_.begin() + i,
+                     (rand_number = correspondence_sampler_.Sample(&rng_))) !=
+           this->sample_indices_.begin() + i) {}
 
-    random_numbers.push_back(rand_number);
-    subset->at(i) = data[rand_number];
+    this->sample_indices_[i] = rand_number;
+    (*subset)[i] = data[rand_number];
   }
   return true;
 }
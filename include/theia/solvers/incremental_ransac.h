@@ -0,0 +1,260 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_INCREMENTAL_RANSAC_H_
+#define THEIA_SOLVERS_INCREMENTAL_RANSAC_H_
+
+#include <glog/logging.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "theia/solvers/estimator.h"
+#include "theia/solvers/random_sampler.h"
+#include "theia/solvers/sample_consensus_estimator.h"
+
+namespace theia {
+// RANSAC over data that arrives over time, e.g. correspondences emitted tile
+// by tile by a matcher. Rather than calling Estimate on the full data, the
+// data is added with AddCorrespondences and the consensus loop is advanced
+// with RunIterations, so that the estimation can be interleaved with the
+// production of the data:
+//
+//   IncrementalRansac<P3PEstimator> ransac(ransac_params, estimator);
+//   ransac.Initialize();
+//   while (matcher.HasMoreTiles()) {
+//     ransac.AddCorrespondences(matcher.NextTile());
+//     ransac.RunIterations(10);
+//   }
+//   while (!ransac.Converged()) {
+//     ransac.RunIterations(10);
+//   }
+//   ransac.CurrentBest(&pose, &summary);
+//
+// When data is added, only the new data points are evaluated on the current
+// best model, so its inliers are kept up to date without scoring it on all
+// of the data again. The number of iterations needed is recomputed from the
+// inlier ratio of the best model as the data grows.
+//
+// As in Step of SampleConsensusEstimator, the cancellation flag is checked at
+// every iteration, the progress callback is called whenever the best model
+// improves, and repeated samples are skipped if use_sample_cache is set. The
+// cached samples are kept when data is added, since the indices of the
+// previous data do not change.
+//
+// SampleConsensusEstimator is inherited privately: its Estimate, Start and
+// Step would run on other data than the data added so far, bypassing the
+// incremental state.
+template <class ModelEstimator>
+class IncrementalRansac : private SampleConsensusEstimator<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+  typedef typename SampleConsensusEstimator<ModelEstimator>::ProgressCallback
+      ProgressCallback;
+
+  using SampleConsensusEstimator<ModelEstimator>::SetProgressCallback;
+  using SampleConsensusEstimator<ModelEstimator>::SetCancellationFlag;
+  using SampleConsensusEstimator<ModelEstimator>::SetModelPrior;
+
+  IncrementalRansac(const RansacParameters& ransac_params,
+                    const ModelEstimator& estimator)
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator) {
+    Reset();
+  }
+  ~IncrementalRansac() {}
+
+  // Initializes the random sampler and the quality measurement.
+  bool Initialize() {
+    Sampler<Datum>* random_sampler =
+        new RandomSampler<Datum>(this->estimator_.SampleSize());
+    Reset();
+    return SampleConsensusEstimator<ModelEstimator>::Initialize(random_sampler);
+  }
+
+  // Removes all of the data and the current best model, e.g. before the next
+  // frame.
+  void Reset() {
+    data_.clear();
+    best_residuals_.clear();
+    best_cost_ = std::numeric_limits<double>::max();
+    best_cost_is_stale_ = false;
+    has_best_model_ = false;
+    num_best_inliers_ = 0;
+    summary_ = RansacSummary();
+    max_iterations_ = this->ransac_params_.max_iterations;
+    num_consecutive_duplicate_samples_ = 0;
+    this->sample_cache_.Reset(0, this->estimator_.SampleSize(),
+                              this->estimator_.SampleOrderMatters());
+  }
+
+  // Appends the data points. The residuals of the new points w.r.t. the
+  // current best model are computed right away, which is O(new points).
+  void AddCorrespondences(const std::vector<Datum>& data) {
+    data_.insert(data_.end(), data.begin(), data.end());
+    this->sample_cache_.Grow(data_.size());
+    if (has_best_model_) {
+      for (const Datum& datum : data) {
+        const double residual = this->estimator_.Error(datum, best_model_);
+        best_residuals_.push_back(residual);
+        if (residual < this->ransac_params_.error_thresh) {
+          num_best_inliers_++;
+        }
+      }
+      // The cost of the best model depends on all of the residuals, so it is
+      // recomputed from them before the next hypothesis is compared to it.
+      best_cost_is_stale_ = true;
+    }
+    UpdateMaxIterations();
+  }
+
+  // Runs at most num_iterations iterations of RANSAC on the data added so far,
+  // stopping early once the estimation has converged or been cancelled.
+  // Returns the number of iterations that were run, which does not include
+  // the skipped duplicate samples.
+  int RunIterations(const int num_iterations) {
+    const int sample_size = this->estimator_.SampleSize();
+    if (data_.size() < sample_size) {
+      return 0;
+    }
+    if (best_cost_is_stale_) {
+      best_cost_ = this->quality_measurement_->ComputeCost(best_residuals_);
+      best_cost_is_stale_ = false;
+    }
+
+    this->workspace_.Reserve(data_.size(), sample_size);
+    const int first_iteration = summary_.num_iterations;
+    for (int num_steps = 0; num_steps < num_iterations && !Converged();
+         num_steps++) {
+      if (this->Cancelled()) {
+        summary_.cancelled = true;
+        break;
+      }
+      summary_.num_iterations++;
+      if (!this->sampler_->Sample(data_, &this->workspace_.data_subset)) {
+        continue;
+      }
+
+      // Skip samples that have already been evaluated, as in
+      // SampleConsensusEstimator::Step. Once every sample of the data has been
+      // evaluated, the estimation has converged until more data is added.
+      if (this->ransac_params_.use_sample_cache &&
+          !this->sample_cache_.Insert(this->sampler_->SampleIndices())) {
+        summary_.num_duplicate_samples++;
+        if (this->sample_cache_.Exhausted()) {
+          max_iterations_ = summary_.num_iterations;
+          break;
+        }
+        if (++num_consecutive_duplicate_samples_ <=
+            this->kMaxConsecutiveDuplicateSamples) {
+          summary_.num_iterations--;
+        }
+        continue;
+      }
+      num_consecutive_duplicate_samples_ = 0;
+
+      if (!this->EvaluateSample(data_, true, &best_model_, &best_cost_,
+                                &best_residuals_, &summary_)) {
+        continue;
+      }
+
+      has_best_model_ = true;
+      num_best_inliers_ = 0;
+      for (const double residual : best_residuals_) {
+        if (residual < this->ransac_params_.error_thresh) {
+          num_best_inliers_++;
+        }
+      }
+      UpdateMaxIterations();
+      this->ReportProgress(best_model_, BestInlierRatio(),
+                           BestModelConfidence());
+    }
+    return summary_.num_iterations - first_iteration;
+  }
+
+  // Returns true once enough iterations have been run to find the best model
+  // on the data added so far with the desired confidence, or once the
+  // estimation has been cancelled. A cancelled estimation is not resumed until
+  // Reset, and RansacSummary::cancelled is set in the summary.
+  bool Converged() const {
+    return summary_.num_iterations >= max_iterations_ || summary_.cancelled;
+  }
+
+  // Fills the best model and the summary (inliers, residuals, iterations and
+  // confidence) for the data added so far. Returns false if no model has been
+  // found yet.
+  bool CurrentBest(Model* best_model, RansacSummary* summary) const {
+    CHECK_NOTNULL(best_model);
+    CHECK_NOTNULL(summary);
+    if (!has_best_model_) {
+      return false;
+    }
+
+    *best_model = best_model_;
+    *summary = summary_;
+    summary->residuals = best_residuals_;
+    this->SetInliersFromResiduals(this->ransac_params_.error_thresh, summary);
+    summary->confidence = BestModelConfidence();
+    return true;
+  }
+
+  // The data added since the last reset.
+  const std::vector<Datum>& Data() const { return data_; }
+
+ private:
+  // The inlier ratio of the best model on the data added so far.
+  double BestInlierRatio() const {
+    return static_cast<double>(num_best_inliers_) / data_.size();
+  }
+
+  // The confidence that the best model has been found after the iterations
+  // run so far, given its inlier ratio.
+  double BestModelConfidence() const {
+    return 1.0 -
+           pow(1.0 - pow(BestInlierRatio(), this->estimator_.SampleSize()),
+               summary_.num_iterations);
+  }
+
+  // Recomputes the number of iterations needed from the inlier ratio of the
+  // best model (or the minimum inlier ratio if that is larger).
+  void UpdateMaxIterations() {
+    max_iterations_ = this->ransac_params_.max_iterations;
+    if (data_.empty()) {
+      return;
+    }
+    const double inlier_ratio =
+        std::max(static_cast<double>(num_best_inliers_) / data_.size(),
+                 this->ransac_params_.min_inlier_ratio);
+    if (inlier_ratio > 0.0) {
+      max_iterations_ = this->ComputeMaxIterations(
+          this->estimator_.SampleSize(), inlier_ratio,
+          log(this->ransac_params_.failure_probability));
+    }
+  }
+
+  // The data added so far.
+  std::vector<Datum> data_;
+
+  // The best model, its cost and its residuals on data_. The cost is stale
+  // after data was added until the next call to RunIterations.
+  Model best_model_;
+  double best_cost_;
+  bool best_cost_is_stale_;
+  std::vector<double> best_residuals_;
+  bool has_best_model_;
+  int num_best_inliers_;
+
+  // The iterations and the rejection counts since the last reset.
+  RansacSummary summary_;
+
+  // The number of iterations needed for the data added so far.
+  int max_iterations_;
+
+  // The number of duplicate samples drawn in a row.
+  int num_consecutive_duplicate_samples_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_INCREMENTAL_RANSAC_H_
@@ -40,6 +40,10 @@ class InlierSupport : public QualityMeasurement {
 
   double GetInlierRatio() const { return max_inlier_ratio_; }
 
+  void ResetInlierRatio() { max_inlier_ratio_ = 0.0; }
+
+  QualityMeasurement* Clone() const { return new InlierSupport(*this); }
+
  private:
   double max_inlier_ratio_;
 };
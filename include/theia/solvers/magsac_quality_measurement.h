@@ -0,0 +1,155 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
+#define THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "theia/math/probability/gamma_distribution.h"
+#include "theia/solvers/quality_measurement.h"
+
+namespace theia {
+// Define the quality metric according to the sigma-consensus of "MAGSAC++, a
+// fast, reliable and accurate robust estimator" by Barath et al. Rather than
+// using a single threshold, the loss of each residual is marginalized over the
+// noise scale sigma in [0, sigma_max], which gives a smooth loss that is
+// quadratic-like for small residuals and constant beyond the maximum threshold.
+//
+// The error threshold is the maximum squared threshold k^2 * sigma_max^2, where
+// k^2 is the 0.99 quantile of the chi-squared distribution with the degrees of
+// freedom of the residuals (2 for a reprojection error). With
+// u = residual / (2 * sigma_max^2), the loss of a squared residual below the
+// threshold is
+//
+//   (gamma((n + 1) / 2, u) + u * (Gamma((n - 1) / 2, u) -
+//       Gamma((n - 1) / 2, k^2 / 2))) / gamma((n + 1) / 2, k^2 / 2),
+//
+// where gamma and Gamma are the lower and upper incomplete gamma functions and
+// n the degrees of freedom, and 1 otherwise. Both incomplete gamma terms are
+// tabulated over [0, k^2 / 2] in Initialize, so the cost is computed in O(N)
+// with table lookups only.
+class MagsacQualityMeasurement : public QualityMeasurement {
+ public:
+  // Params:
+  //   error_thresh:  The maximum squared threshold.
+  //   degrees_of_freedom:  The degrees of freedom of the residuals, at least 2.
+  explicit MagsacQualityMeasurement(const double error_thresh,
+                                    const int degrees_of_freedom = 2)
+      : QualityMeasurement(error_thresh),
+        degrees_of_freedom_(degrees_of_freedom) {
+    CHECK_GE(degrees_of_freedom_, 2);
+  }
+
+  ~MagsacQualityMeasurement() {}
+
+  bool Initialize() {
+    static const double kChiSquaredQuantile = 0.99;
+    max_inlier_ratio_ = 0.0;
+
+    // Find the 0.99 quantile of the chi-squared distribution by bisection on
+    // its cdf P(n / 2, x / 2).
+    const double half_dof = 0.5 * degrees_of_freedom_;
+    double lower = 0.0;
+    double upper = 1.0;
+    while (RegularizedLowerIncompleteGamma(half_dof, 0.5 * upper) <
+           kChiSquaredQuantile) {
+      upper *= 2.0;
+    }
+    for (int i = 0; i < 100; i++) {
+      const double middle = 0.5 * (lower + upper);
+      if (RegularizedLowerIncompleteGamma(half_dof, 0.5 * middle) <
+          kChiSquaredQuantile) {
+        lower = middle;
+      } else {
+        upper = middle;
+      }
+    }
+    const double k_squared = 0.5 * (lower + upper);
+
+    // residual / (2 * sigma_max^2) for residual = k^2 * sigma_max^2.
+    const double max_u = 0.5 * k_squared;
+    u_per_residual_ = max_u / error_thresh_;
+    table_index_per_u_ = (kTableSize - 1) / max_u;
+
+    // Tabulate the (unregularized) incomplete gamma terms.
+    const double a = 0.5 * (degrees_of_freedom_ + 1.0);
+    const double b = 0.5 * (degrees_of_freedom_ - 1.0);
+    const double gamma_a = std::tgamma(a);
+    const double gamma_b = std::tgamma(b);
+    lower_incomplete_gamma_.resize(kTableSize);
+    upper_incomplete_gamma_.resize(kTableSize);
+    for (int i = 0; i < kTableSize; i++) {
+      const double u = i / table_index_per_u_;
+      lower_incomplete_gamma_[i] =
+          gamma_a * RegularizedLowerIncompleteGamma(a, u);
+      upper_incomplete_gamma_[i] =
+          gamma_b * RegularizedUpperIncompleteGamma(b, u);
+    }
+    upper_incomplete_gamma_at_threshold_ = upper_incomplete_gamma_.back();
+    inverse_outlier_loss_ = 1.0 / lower_incomplete_gamma_.back();
+    return true;
+  }
+
+  // Given the residuals, assess a quality metric for the data. This is the sum
+  // of the marginalized losses, so lower is better.
+  double ComputeCost(const std::vector<double>& residuals) {
+    double num_inliers = 0.0;
+    double cost = 0.0;
+    for (int i = 0; i < residuals.size(); i++) {
+      if (residuals[i] >= error_thresh_) {
+        cost += 1.0;
+        continue;
+      }
+      num_inliers += 1.0;
+      const double u = residuals[i] * u_per_residual_;
+      const int index = static_cast<int>(u * table_index_per_u_ + 0.5);
+      cost += (lower_incomplete_gamma_[index] +
+               u * (upper_incomplete_gamma_[index] -
+                    upper_incomplete_gamma_at_threshold_)) *
+              inverse_outlier_loss_;
+    }
+    const double inlier_ratio =
+        num_inliers / static_cast<double>(residuals.size());
+    max_inlier_ratio_ = std::max(inlier_ratio, max_inlier_ratio_);
+    return cost;
+  }
+
+  // The inlier ratio with respect to the maximum threshold.
+  double GetInlierRatio() const { return max_inlier_ratio_; }
+
+  void ResetInlierRatio() { max_inlier_ratio_ = 0.0; }
+
+  QualityMeasurement* Clone() const {
+    return new MagsacQualityMeasurement(*this);
+  }
+
+ private:
+  // The number of entries of the incomplete gamma tables.
+  static const int kTableSize = 4096;
+
+  const int degrees_of_freedom_;
+
+  // Scale factors from a squared residual to u and from u to a table index.
+  double u_per_residual_;
+  double table_index_per_u_;
+
+  // gamma((n + 1) / 2, u) and Gamma((n - 1) / 2, u) at uniformly spaced u in
+  // [0, k^2 / 2].
+  std::vector<double> lower_incomplete_gamma_;
+  std::vector<double> upper_incomplete_gamma_;
+  double upper_incomplete_gamma_at_threshold_;
+
+  // The inverse of the loss at the threshold, which normalizes the losses to
+  // [0, 1].
+  double inverse_outlier_loss_;
+
+  double max_inlier_ratio_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
@@ -50,6 +50,12 @@ class MLEQualityMeasurement : public QualityMeasurement {
 
   double GetInlierRatio() const { return max_inlier_ratio_; }
 
+  void ResetInlierRatio() { max_inlier_ratio_ = 0.0; }
+
+  QualityMeasurement* Clone() const {
+    return new MLEQualityMeasurement(*this);
+  }
+
  private:
   double max_inlier_ratio_;
 };
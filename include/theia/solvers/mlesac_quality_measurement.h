@@ -0,0 +1,152 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_MLESAC_QUALITY_MEASUREMENT_H_
+#define THEIA_SOLVERS_MLESAC_QUALITY_MEASUREMENT_H_
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "theia/math/distribution.h"
+#include "theia/solvers/quality_measurement.h"
+
+namespace theia {
+// Define the quality metric according to "MLESAC: A new robust estimator with
+// application to estimating image geometry" by Torr and Zisserman. The
+// residuals are squared 2D errors (e.g. the squared reprojection error of
+// P3PEstimator). With Gaussian noise of standard deviation sigma in each
+// coordinate, the inlier residuals follow sigma^2 times a chi-squared
+// distribution with 2 degrees of freedom, i.e. an exponential distribution,
+// and the outliers are uniform:
+//
+//   p(r) = gamma * exp(-r / (2 sigma^2)) / (2 sigma^2) + (1 - gamma) / v,
+//
+// where v is the range of the outlier residuals, above which residuals are
+// clamped.
+// Unlike MLEQualityMeasurement, which scores a model with a truncated cost, the
+// mixing ratio gamma is estimated for each model with a few iterations of EM,
+// and the cost is the negative log likelihood of the residuals under the
+// mixture. The estimated mixing ratio is used as the inlier ratio.
+//
+// The likelihoods of the residuals under both distributions are computed once
+// per model with Distribution::EvalBatch, and the EM iterations only combine
+// them with vectorized array operations.
+class MlesacQualityMeasurement : public QualityMeasurement {
+ public:
+  // Params:
+  //   error_thresh:  The squared error threshold. By default it is the 95%
+  //     quantile of the inlier residuals, i.e. sigma^2 = error_thresh / 5.991,
+  //     and the outlier range is 10 * error_thresh.
+  explicit MlesacQualityMeasurement(const double error_thresh)
+      : MlesacQualityMeasurement(error_thresh,
+                                 std::sqrt(error_thresh / kInlierQuantile),
+                                 kOutlierRangeRatio * error_thresh) {}
+
+  // Params:
+  //   error_thresh:  The squared error threshold.
+  //   sigma:  The standard deviation of the inlier noise in each coordinate.
+  //   outlier_range:  The range v of the outlier residuals.
+  //   num_em_iterations:  The maximum number of EM iterations per model.
+  MlesacQualityMeasurement(const double error_thresh,
+                           const double sigma,
+                           const double outlier_range,
+                           const int num_em_iterations = 5)
+      : QualityMeasurement(error_thresh),
+        inlier_distribution_(1.0 / (2.0 * sigma * sigma)),
+        outlier_distribution_(0.0, outlier_range),
+        outlier_range_(outlier_range),
+        num_em_iterations_(num_em_iterations) {
+    CHECK_GT(num_em_iterations_, 0);
+  }
+
+  ~MlesacQualityMeasurement() {}
+
+  bool Initialize() {
+    max_inlier_ratio_ = 0.0;
+    mixing_ratio_ = 0.0;
+    return true;
+  }
+
+  // Given the residuals, estimates the mixing ratio with EM and returns the
+  // negative log likelihood of the residuals under the mixture, so lower is
+  // better.
+  double ComputeCost(const std::vector<double>& residuals) {
+    static const double kMinMixingRatioChange = 1e-4;
+    const int num_residuals = residuals.size();
+    if (num_residuals == 0) {
+      return 0.0;
+    }
+
+    clamped_residuals_ =
+        Eigen::Map<const Eigen::ArrayXd>(residuals.data(), num_residuals)
+            .max(0.0)
+            .min(outlier_range_);
+    inlier_likelihoods_.resize(num_residuals);
+    outlier_likelihoods_.resize(num_residuals);
+    inlier_distribution_.EvalBatch(clamped_residuals_.data(), num_residuals,
+                                   inlier_likelihoods_.data());
+    outlier_distribution_.EvalBatch(clamped_residuals_.data(), num_residuals,
+                                    outlier_likelihoods_.data());
+    // EM: the expected inlier probability of each residual given the current
+    // mixing ratio is averaged into the next mixing ratio.
+    double mixing_ratio = 0.5;
+    for (int i = 0; i < num_em_iterations_; i++) {
+      const double new_mixing_ratio =
+          (mixing_ratio * inlier_likelihoods_ /
+           (mixing_ratio * inlier_likelihoods_ +
+            (1.0 - mixing_ratio) * outlier_likelihoods_))
+              .mean();
+      const double change = std::abs(new_mixing_ratio - mixing_ratio);
+      mixing_ratio = new_mixing_ratio;
+      if (change < kMinMixingRatioChange) {
+        break;
+      }
+    }
+
+    mixing_ratio_ = mixing_ratio;
+    max_inlier_ratio_ = std::max(mixing_ratio, max_inlier_ratio_);
+    return -(mixing_ratio * inlier_likelihoods_ +
+             (1.0 - mixing_ratio) * outlier_likelihoods_)
+                .log()
+                .sum();
+  }
+
+  // Returns the maximum mixing ratio estimated so far.
+  double GetInlierRatio() const { return max_inlier_ratio_; }
+
+  void ResetInlierRatio() { max_inlier_ratio_ = 0.0; }
+
+  QualityMeasurement* Clone() const {
+    return new MlesacQualityMeasurement(*this);
+  }
+
+  // The mixing ratio estimated by the last call to ComputeCost.
+  double mixing_ratio() const { return mixing_ratio_; }
+
+ private:
+  // The 95% quantile of the chi-squared distribution with 2 degrees of
+  // freedom, i.e. -2 log(0.05), which is error_thresh / sigma^2 by default.
+  static constexpr double kInlierQuantile = 5.991465;
+  static constexpr double kOutlierRangeRatio = 10.0;
+
+  ExponentialDistribution inlier_distribution_;
+  UniformDistribution outlier_distribution_;
+  const double outlier_range_;
+  const int num_em_iterations_;
+
+  // The clamped residuals and their likelihoods under both distributions,
+  // kept between calls to avoid allocating them for every model.
+  Eigen::ArrayXd clamped_residuals_;
+  Eigen::ArrayXd inlier_likelihoods_;
+  Eigen::ArrayXd outlier_likelihoods_;
+
+  double mixing_ratio_;
+  double max_inlier_ratio_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MLESAC_QUALITY_MEASUREMENT_H_
@@ -0,0 +1,25 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_MODEL_PRIOR_H_
+#define THEIA_SOLVERS_MODEL_PRIOR_H_
+
+namespace theia {
+// Prior knowledge of the model to be estimated, e.g. a pose predicted by
+// odometry or an IMU up to some tolerance. Once set on a sample consensus
+// estimator (see SampleConsensusEstimator::SetModelPrior), every hypothesis
+// that is inconsistent with the prior is rejected before it is scored on the
+// data.
+template <class Model> class ModelPrior {
+ public:
+  ModelPrior() {}
+  virtual ~ModelPrior() {}
+
+  // Returns true if the model is consistent with the prior. This is called
+  // for every hypothesis, so it should be O(1).
+  virtual bool IsConsistent(const Model& model) const = 0;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MODEL_PRIOR_H_
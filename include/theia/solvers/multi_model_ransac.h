@@ -0,0 +1,306 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_MULTI_MODEL_RANSAC_H_
+#define THEIA_SOLVERS_MULTI_MODEL_RANSAC_H_
+
+#include <glog/logging.h>
+#include <stdint.h>
+#include <algorithm>
+#include <bitset>
+#include <utility>
+#include <vector>
+
+#include "theia/math/graph/dense_connected_components.h"
+#include "theia/solvers/estimator.h"
+#include "theia/solvers/random_sampler.h"
+#include "theia/solvers/sample_consensus_estimator.h"
+
+namespace theia {
+// Estimates several models from the same data, e.g. the poses of several rigid
+// objects seen in one image, in a single pass instead of running RANSAC once
+// per model and removing the inliers by hand in between.
+//
+// The estimation follows the preference-set clustering of J-linkage (Toldo and
+// Fusiello, "Robust multiple structures estimation with J-linkage"):
+//   1. num_hypotheses hypotheses are generated from random minimal samples.
+//      Each one is scored on all of the data, which gives its cost and its
+//      consensus set, stored as a bitset over the data. The residuals
+//      themselves are not kept.
+//   2. Hypotheses with at least min_num_inliers inliers are clustered with
+//      DenseConnectedComponents: two hypotheses are linked if the Jaccard
+//      distance of their consensus sets is at most max_jaccard_distance, and
+//      the clusters are the connected components of these links. Each cluster
+//      corresponds to one structure in the data.
+//   3. The hypothesis with the lowest cost of each cluster represents it, and
+//      the representatives with the most inliers are kept.
+//   4. The kept models are scored on the data a second time, into a shared
+//      residual matrix, and each datum is assigned to the model with the
+//      smallest residual below the threshold, so the inlier sets are disjoint.
+//
+// Unlike J-linkage, which merges the two closest clusters at a time, the
+// connected components amount to single-linkage clustering: a chain of
+// hypotheses whose consecutive consensus sets overlap, e.g. hypotheses fit to
+// the inliers of two nearby structures, merges both structures into one
+// cluster. Only the representative of that cluster is then returned, so
+// max_jaccard_distance should be lowered if structures share many data.
+template <class ModelEstimator>
+class MultiModelRansac : public SampleConsensusEstimator<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+
+  // Params:
+  //   max_num_models:  The maximum number of models to return.
+  //   min_num_inliers:  The minimum number of inliers of a returned model.
+  //   num_hypotheses:  The number of minimal samples drawn.
+  //   max_jaccard_distance:  The maximum Jaccard distance between the
+  //     consensus sets of two hypotheses of the same structure.
+  MultiModelRansac(const RansacParameters& ransac_params,
+                   const ModelEstimator& estimator,
+                   const int max_num_models,
+                   const int min_num_inliers,
+                   const int num_hypotheses = 1000,
+                   const double max_jaccard_distance = 0.5)
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator),
+        max_num_models_(max_num_models),
+        min_num_inliers_(min_num_inliers),
+        num_hypotheses_(num_hypotheses),
+        max_jaccard_distance_(max_jaccard_distance) {
+    CHECK_GT(max_num_models_, 0);
+    CHECK_GT(min_num_inliers_, 0);
+    CHECK_GT(num_hypotheses_, 0);
+    CHECK_GE(max_jaccard_distance_, 0.0);
+    CHECK_LE(max_jaccard_distance_, 1.0);
+  }
+  ~MultiModelRansac() {}
+
+  // Initializes the random sampler and the quality measurement.
+  bool Initialize() {
+    Sampler<Datum>* random_sampler =
+        new RandomSampler<Datum>(this->estimator_.SampleSize());
+    return SampleConsensusEstimator<ModelEstimator>::Initialize(random_sampler);
+  }
+
+  // Estimates up to max_num_models models from the data. models are sorted by
+  // decreasing number of inliers, and inliers[k] holds the indices of the data
+  // assigned to models[k]. Returns false if no model with at least
+  // min_num_inliers inliers was found.
+  bool EstimateModels(const std::vector<Datum>& data,
+                      std::vector<Model>* models,
+                      std::vector<std::vector<int> >* inliers);
+
+ private:
+  // Generates the hypotheses and stores their costs, inlier counts and
+  // consensus sets.
+  void GenerateHypotheses(const std::vector<Datum>& data);
+
+  // Clusters the hypotheses and returns the representative of each cluster,
+  // sorted by decreasing number of inliers.
+  void ClusterHypotheses(std::vector<int>* representatives) const;
+
+  // The Jaccard distance between the consensus sets of two hypotheses.
+  double JaccardDistance(const int hypothesis1, const int hypothesis2) const;
+
+  const int max_num_models_;
+  const int min_num_inliers_;
+  const int num_hypotheses_;
+  const double max_jaccard_distance_;
+
+  // The hypotheses with at least min_num_inliers_ inliers, their costs, their
+  // inlier counts and their consensus sets. The consensus set of hypothesis h
+  // is stored in consensus_sets_[h * num_words_] to
+  // consensus_sets_[(h + 1) * num_words_ - 1], one bit per datum.
+  std::vector<Model> hypotheses_;
+  std::vector<double> costs_;
+  std::vector<int> num_inliers_;
+  std::vector<uint64_t> consensus_sets_;
+  int num_words_;
+};
+
+// --------------------------- Implementation --------------------------------//
+
+template <class ModelEstimator>
+void MultiModelRansac<ModelEstimator>::GenerateHypotheses(
+    const std::vector<Datum>& data) {
+  const double error_thresh = this->ransac_params_.error_thresh;
+  num_words_ = (data.size() + 63) / 64;
+  hypotheses_.clear();
+  costs_.clear();
+  num_inliers_.clear();
+  consensus_sets_.clear();
+
+  std::vector<Datum>& data_subset = this->workspace_.data_subset;
+  std::vector<Model>& temp_models = this->workspace_.models;
+  std::vector<double>& residuals = this->workspace_.residuals;
+  for (int i = 0; i < num_hypotheses_ && !this->Cancelled(); i++) {
+    if (!this->sampler_->Sample(data, &data_subset) ||
+        !this->estimator_.ValidSample(data_subset)) {
+      continue;
+    }
+    temp_models.clear();
+    if (!this->estimator_.EstimateModel(data_subset, &temp_models)) {
+      continue;
+    }
+
+    for (const Model& temp_model : temp_models) {
+      if ((this->model_prior_ != nullptr &&
+           !this->model_prior_->IsConsistent(temp_model)) ||
+          !this->estimator_.ValidModel(temp_model) ||
+          !this->estimator_.ValidModelForSample(data_subset, temp_model,
+                                                error_thresh)) {
+        continue;
+      }
+
+      // The residuals are reduced to a cost and a consensus set. Keeping them
+      // for every hypothesis would take num_hypotheses_ times the size of the
+      // data, so the few kept models are scored again in EstimateModels.
+      this->estimator_.ComputeResiduals(data, temp_model, &residuals);
+      int num_inliers = 0;
+      for (const double residual : residuals) {
+        if (residual < error_thresh) {
+          num_inliers++;
+        }
+      }
+      if (num_inliers < min_num_inliers_) {
+        continue;
+      }
+
+      hypotheses_.push_back(temp_model);
+      costs_.push_back(this->quality_measurement_->ComputeCost(residuals));
+      num_inliers_.push_back(num_inliers);
+      consensus_sets_.resize(consensus_sets_.size() + num_words_, 0);
+      uint64_t* consensus_set = &consensus_sets_[consensus_sets_.size() -
+                                                 num_words_];
+      for (int j = 0; j < residuals.size(); j++) {
+        if (residuals[j] < error_thresh) {
+          consensus_set[j / 64] |= uint64_t(1) << (j % 64);
+        }
+      }
+    }
+  }
+}
+
+template <class ModelEstimator>
+double MultiModelRansac<ModelEstimator>::JaccardDistance(
+    const int hypothesis1, const int hypothesis2) const {
+  const uint64_t* consensus_set1 = &consensus_sets_[hypothesis1 * num_words_];
+  const uint64_t* consensus_set2 = &consensus_sets_[hypothesis2 * num_words_];
+  int num_shared_inliers = 0;
+  for (int i = 0; i < num_words_; i++) {
+    num_shared_inliers +=
+        std::bitset<64>(consensus_set1[i] & consensus_set2[i]).count();
+  }
+  const int num_union = num_inliers_[hypothesis1] + num_inliers_[hypothesis2] -
+                        num_shared_inliers;
+  return 1.0 - static_cast<double>(num_shared_inliers) / num_union;
+}
+
+template <class ModelEstimator>
+void MultiModelRansac<ModelEstimator>::ClusterHypotheses(
+    std::vector<int>* representatives) const {
+  const int num_hypotheses = hypotheses_.size();
+  std::vector<std::pair<int, int> > edges;
+  for (int i = 0; i < num_hypotheses; i++) {
+    for (int j = i + 1; j < num_hypotheses; j++) {
+      if (JaccardDistance(i, j) <= max_jaccard_distance_) {
+        edges.emplace_back(i, j);
+      }
+    }
+  }
+  DenseConnectedComponents connected_components(num_hypotheses);
+  connected_components.AddEdges(edges);
+  std::vector<int> cluster_offsets;
+  std::vector<int> cluster_hypotheses;
+  connected_components.Extract(&cluster_offsets, &cluster_hypotheses);
+
+  const int num_clusters = cluster_offsets.size() - 1;
+  representatives->resize(num_clusters);
+  for (int c = 0; c < num_clusters; c++) {
+    int representative = cluster_hypotheses[cluster_offsets[c]];
+    for (int k = cluster_offsets[c] + 1; k < cluster_offsets[c + 1]; k++) {
+      if (costs_[cluster_hypotheses[k]] < costs_[representative]) {
+        representative = cluster_hypotheses[k];
+      }
+    }
+    (*representatives)[c] = representative;
+  }
+  std::sort(representatives->begin(), representatives->end(),
+            [this](const int i, const int j) {
+              return num_inliers_[i] > num_inliers_[j] ||
+                     (num_inliers_[i] == num_inliers_[j] && i < j);
+            });
+}
+
+template <class ModelEstimator>
+bool MultiModelRansac<ModelEstimator>::EstimateModels(
+    const std::vector<Datum>& data,
+    std::vector<Model>* models,
+    std::vector<std::vector<int> >* inliers) {
+  CHECK_GT(data.size(), 0)
+      << "Cannot perform estimation with 0 data measurements!";
+  CHECK_NOTNULL(this->sampler_.get());
+  CHECK_NOTNULL(this->quality_measurement_.get());
+  CHECK_NOTNULL(models)->clear();
+  CHECK_NOTNULL(inliers)->clear();
+
+  this->workspace_.Reserve(data.size(), this->estimator_.SampleSize());
+  GenerateHypotheses(data);
+  std::vector<int> representatives;
+  ClusterHypotheses(&representatives);
+  if (representatives.size() > max_num_models_) {
+    representatives.resize(max_num_models_);
+  }
+  const int num_models = representatives.size();
+
+  // The residuals of the selected models, one row per model, are shared by
+  // the assignment of all of the data.
+  std::vector<double> residuals(num_models * data.size());
+  for (int k = 0; k < num_models; k++) {
+    std::vector<double>& model_residuals = this->workspace_.residuals;
+    this->estimator_.ComputeResiduals(data, hypotheses_[representatives[k]],
+                                      &model_residuals);
+    std::copy(model_residuals.begin(), model_residuals.end(),
+              residuals.begin() + k * data.size());
+  }
+
+  // Assign each datum to the model that fits it best so that the inlier sets
+  // are disjoint.
+  std::vector<std::vector<int> > model_inliers(num_models);
+  for (int i = 0; i < data.size(); i++) {
+    int best_model = -1;
+    double best_residual = this->ransac_params_.error_thresh;
+    for (int k = 0; k < num_models; k++) {
+      if (residuals[k * data.size() + i] < best_residual) {
+        best_residual = residuals[k * data.size() + i];
+        best_model = k;
+      }
+    }
+    if (best_model >= 0) {
+      model_inliers[best_model].push_back(i);
+    }
+  }
+
+  // Drop the models that lost too many inliers to the other models.
+  std::vector<int> order(num_models);
+  for (int k = 0; k < num_models; k++) {
+    order[k] = k;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&model_inliers](const int k1, const int k2) {
+                     return model_inliers[k1].size() >
+                            model_inliers[k2].size();
+                   });
+  for (const int k : order) {
+    if (model_inliers[k].size() < min_num_inliers_) {
+      break;
+    }
+    models->push_back(hypotheses_[representatives[k]]);
+    inliers->push_back(std::move(model_inliers[k]));
+  }
+  return !models->empty();
+}
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MULTI_MODEL_RANSAC_H_
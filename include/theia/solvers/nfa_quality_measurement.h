@@ -0,0 +1,178 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_NFA_QUALITY_MEASUREMENT_H_
+#define THEIA_SOLVERS_NFA_QUALITY_MEASUREMENT_H_
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "theia/math/histogram.h"
+#include "theia/solvers/quality_measurement.h"
+
+namespace theia {
+// Define the quality metric as the Number of False Alarms (NFA) of the a
+// contrario framework of "A Probabilistic Criterion to Detect Rigid Point
+// Matches Between Two Images and Estimate the Fundamental Matrix" by Moisan and
+// Stival. For a model whose k smallest residuals are below eps,
+//
+//   NFA(k, eps) = N_out * (n - m) * C(n, k) * C(k, m) * alpha(eps)^(k - m),
+//
+// where n is the number of data points, m the sample size, N_out the maximum
+// number of models estimated from a sample, and alpha(eps) = alpha0 * eps the
+// probability that the residual of a random datum is below eps. The cost of a
+// model is its minimal log NFA over the thresholds, and a model is meaningful
+// if it is negative.
+//
+// Rather than sorting the residuals of every model, the residuals are binned
+// into a histogram with logarithmically spaced boundaries up to the error
+// threshold, and the NFA is only evaluated at the bin boundaries. This makes
+// the cost O(N) per model at the expense of quantizing the threshold.
+class NfaQualityMeasurement : public QualityMeasurement {
+ public:
+  // Params:
+  //   error_thresh:  The maximum threshold, i.e. the last bin boundary.
+  //   sample_size:  The minimal sample size m.
+  //   alpha0:  The probability per unit of residual that a random datum is an
+  //     inlier, e.g. pi / A for squared reprojection errors in an image of area
+  //     A (in the units of the residuals).
+  //   num_models_per_sample:  The maximum number of models estimated from a
+  //     sample.
+  //   num_bins:  The number of bins of the residual histogram.
+  NfaQualityMeasurement(const double error_thresh,
+                        const int sample_size,
+                        const double alpha0,
+                        const int num_models_per_sample = 1,
+                        const int num_bins = 64)
+      : QualityMeasurement(error_thresh),
+        sample_size_(sample_size),
+        log_alpha0_(std::log(alpha0)),
+        log_num_models_per_sample_(std::log(num_models_per_sample)),
+        histogram_(Histogram<double>::LogUniform(
+            kMinThresholdRatio * error_thresh, error_thresh, num_bins - 1)) {
+    CHECK_GT(alpha0, 0.0);
+    CHECK_GT(num_models_per_sample, 0);
+    CHECK_GT(num_bins, 1);
+    boundaries_.resize(num_bins);
+    for (int i = 0; i < num_bins; i++) {
+      boundaries_[i] = histogram_.Boundary(i);
+    }
+  }
+
+  ~NfaQualityMeasurement() {}
+
+  bool Initialize() {
+    max_inlier_ratio_ = 0.0;
+    threshold_ = error_thresh_;
+    log_nfa_ = std::numeric_limits<double>::max();
+    log_alpha_.resize(boundaries_.size());
+    for (int i = 0; i < boundaries_.size(); i++) {
+      log_alpha_[i] = std::min(0.0, log_alpha0_ + std::log(boundaries_[i]));
+    }
+    return true;
+  }
+
+  // Given the residuals, returns the minimal log NFA over the thresholds.
+  double ComputeCost(const std::vector<double>& residuals) {
+    const int num_data = residuals.size();
+    if (log_combinations_.size() != num_data + 1) {
+      ComputeLogCombinations(num_data);
+    }
+
+    // The boundaries are spaced logarithmically, so the bin of each residual
+    // is computed directly rather than with a binary search.
+    histogram_.Reset();
+    histogram_.AddBatch(residuals.data(), num_data);
+
+    // The number of residuals below boundary i is the count of the bins up to
+    // and including bin i.
+    const double log_num_tests =
+        log_num_models_per_sample_ + std::log(num_data - sample_size_);
+    double best_log_nfa = std::numeric_limits<double>::max();
+    int best_num_inliers = 0;
+    int num_inliers = 0;
+    for (int i = 0; i < boundaries_.size(); i++) {
+      num_inliers += histogram_.BinCount(i);
+      if (num_inliers <= sample_size_) {
+        continue;
+      }
+      const double log_nfa = log_num_tests + log_combinations_[num_inliers] +
+                             log_sample_combinations_[num_inliers] +
+                             (num_inliers - sample_size_) * log_alpha_[i];
+      if (log_nfa < best_log_nfa) {
+        best_log_nfa = log_nfa;
+        best_num_inliers = num_inliers;
+        threshold_ = boundaries_[i];
+      }
+    }
+
+    log_nfa_ = best_log_nfa;
+    if (best_log_nfa < 0.0) {
+      max_inlier_ratio_ =
+          std::max(static_cast<double>(best_num_inliers) / num_data,
+                   max_inlier_ratio_);
+    }
+    return best_log_nfa;
+  }
+
+  // Returns the maximum inlier ratio of the meaningful models, each at its own
+  // threshold.
+  double GetInlierRatio() const { return max_inlier_ratio_; }
+
+  void ResetInlierRatio() { max_inlier_ratio_ = 0.0; }
+
+  QualityMeasurement* Clone() const {
+    return new NfaQualityMeasurement(*this);
+  }
+
+  // The threshold and log NFA found by the last call to ComputeCost.
+  double threshold() const { return threshold_; }
+  double log_nfa() const { return log_nfa_; }
+
+ private:
+  // The boundaries are spaced logarithmically over four orders of magnitude up
+  // to the maximum threshold.
+  static constexpr double kMinThresholdRatio = 1e-4;
+
+  // Computes log(C(n, k)) and log(C(k, m)) for k = 0, ..., n.
+  void ComputeLogCombinations(const int num_data) {
+    log_combinations_.resize(num_data + 1);
+    log_sample_combinations_.resize(num_data + 1);
+    const double log_factorial_n = std::lgamma(num_data + 1.0);
+    const double log_factorial_m = std::lgamma(sample_size_ + 1.0);
+    for (int k = 0; k <= num_data; k++) {
+      const double log_factorial_k = std::lgamma(k + 1.0);
+      log_combinations_[k] =
+          log_factorial_n - log_factorial_k - std::lgamma(num_data - k + 1.0);
+      log_sample_combinations_[k] =
+          k < sample_size_ ? 0.0
+                           : log_factorial_k - log_factorial_m -
+                                 std::lgamma(k - sample_size_ + 1.0);
+    }
+  }
+
+  const int sample_size_;
+  const double log_alpha0_;
+  const double log_num_models_per_sample_;
+
+  // The histogram of the residuals, the thresholds at which the NFA is
+  // evaluated (i.e. the histogram boundaries) and log(alpha) at each of them.
+  Histogram<double> histogram_;
+  std::vector<double> boundaries_;
+  std::vector<double> log_alpha_;
+
+  // log(C(n, k)) and log(C(k, m)) for the current number of data points.
+  std::vector<double> log_combinations_;
+  std::vector<double> log_sample_combinations_;
+
+  double threshold_;
+  double log_nfa_;
+  double max_inlier_ratio_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_NFA_QUALITY_MEASUREMENT_H_
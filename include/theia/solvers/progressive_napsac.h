@@ -0,0 +1,67 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
+#define THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
+
+#include <Eigen/Core>
+#include <vector>
+
+#include "theia/solvers/estimator.h"
+#include "theia/solvers/progressive_napsac_sampler.h"
+#include "theia/solvers/sample_consensus_estimator.h"
+
+namespace theia {
+// Estimate a model using the progressive NAPSAC sampler, which draws samples
+// from spatially local neighbourhoods before blending toward global sampling
+// (see progressive_napsac_sampler.h). The 2D position of each data point must
+// be given with SetPositions before calling Estimate, otherwise the data is
+// sampled uniformly as in RANSAC.
+template <class ModelEstimator>
+class ProgressiveNapsac : public SampleConsensusEstimator<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+
+  ProgressiveNapsac(const RansacParameters& ransac_params,
+                    const ModelEstimator& estimator)
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator),
+        napsac_sampler_(nullptr) {}
+  ~ProgressiveNapsac() {}
+
+  bool Initialize() {
+    napsac_sampler_ =
+        new ProgressiveNapsacSampler<Datum>(this->estimator_.SampleSize());
+    napsac_sampler_->SetPositions(&positions_);
+    return SampleConsensusEstimator<ModelEstimator>::Initialize(
+        napsac_sampler_);
+  }
+
+  // Sets the 2D positions (e.g. normalized image coordinates) of the data
+  // passed to the following calls to Estimate.
+  void SetPositions(const std::vector<Eigen::Vector2d>& positions) {
+    positions_ = positions;
+    if (napsac_sampler_ != nullptr) {
+      napsac_sampler_->SetPositions(&positions_);
+    }
+  }
+
+  // Each estimation rebuilds the grid and restarts the progressive sampling
+  // from the finest neighbourhoods.
+  void Start(const std::vector<Datum>& data,
+             Model* best_model,
+             RansacSummary* summary) {
+    CHECK_NOTNULL(napsac_sampler_)->Reset();
+    SampleConsensusEstimator<ModelEstimator>::Start(data, best_model, summary);
+  }
+
+ private:
+  // The 2D positions of the data.
+  std::vector<Eigen::Vector2d> positions_;
+
+  // The sampler set up in Initialize. Owned by the base class.
+  ProgressiveNapsacSampler<Datum>* napsac_sampler_;
+};
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
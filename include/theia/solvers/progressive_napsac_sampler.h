@@ -0,0 +1,277 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
+#define THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "theia/solvers/sampler.h"
+
+namespace theia {
+// Progressive NAPSAC sampler implemented according to the sampler of
+// "MAGSAC++, a fast, reliable and accurate robust estimator" by Barath et al.
+// Inliers tend to be spatially coherent, so a sample drawn from the
+// neighbourhood of a point is much more likely to be all-inlier than a sample
+// drawn from the whole image.
+//
+// The 2D positions of the data (e.g. normalized image coordinates) are indexed
+// by a multi-level grid whose finest level has 2^(num_levels - 1) cells per
+// side and whose coarsest level is a single cell. Each level stores the points
+// bucketed by cell (CSR layout), which is built in O(N) per level. A sample is
+// made of a randomly chosen center point and m - 1 points of its cell. Every
+// center starts at the finest level with at least m points and moves to the
+// next coarser level once it has been the center of as many samples as there
+// are points in its cell. In addition, the samples are progressively blended
+// toward global sampling: the kth sample is drawn uniformly from all of the
+// data with probability min(1, k / num_blending_iterations).
+//
+// The grid is built lazily from the positions on the first call to Sample, and
+// is rebuilt after Reset() (e.g. between frames) or when the data size changes.
+template <class Datum> class ProgressiveNapsacSampler : public Sampler<Datum> {
+ public:
+  ProgressiveNapsacSampler(const int min_num_samples,
+                           const int num_levels = 5,
+                           const int num_blending_iterations = 1000)
+      : Sampler<Datum>(min_num_samples),
+        num_levels_(num_levels),
+        num_blending_iterations_(num_blending_iterations),
+        kth_sample_number_(1),
+        num_data_(0),
+        positions_(nullptr) {
+    CHECK_GT(num_levels_, 0);
+    CHECK_GT(num_blending_iterations_, 0);
+  }
+  ~ProgressiveNapsacSampler() {}
+
+  bool Initialize() {
+    rng_.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    Reset();
+    return true;
+  }
+
+  // Restarts the progressive sampling from the finest neighbourhoods. The grid
+  // is rebuilt from the positions on the next call to Sample.
+  void Reset() {
+    kth_sample_number_ = 1;
+    num_data_ = 0;
+  }
+
+  // Re-seeds the random number generator, e.g. to make the samples of a frame
+  // reproducible.
+  void SetSeed(const unsigned seed) { rng_.seed(seed); }
+
+  // Sets the 2D position of each data point. The positions are not copied and
+  // must outlive the sampler. Without positions the data is sampled uniformly.
+  void SetPositions(const std::vector<Eigen::Vector2d>* positions) {
+    positions_ = positions;
+    num_data_ = 0;
+  }
+
+  // Samples the input variable data and fills the vector subset with the
+  // samples.
+  bool Sample(const std::vector<Datum>& data, std::vector<Datum>* subset) {
+    CHECK_GE(data.size(), this->min_num_samples_);
+    const bool use_positions = positions_ != nullptr && !positions_->empty();
+    if (use_positions) {
+      CHECK_EQ(positions_->size(), data.size())
+          << "The positions do not match the size of the data!";
+    }
+    if (num_data_ != data.size()) {
+      BuildGrid(data.size(), use_positions);
+    }
+    subset->resize(this->min_num_samples_);
+    this->sample_indices_.resize(this->min_num_samples_);
+
+    std::uniform_real_distribution<double> blending_distribution(0.0, 1.0);
+    const double global_sampling_probability =
+        static_cast<double>(kth_sample_number_) / num_blending_iterations_;
+    kth_sample_number_++;
+    if (!use_positions ||
+        blending_distribution(rng_) < global_sampling_probability) {
+      SampleGlobally(data, subset);
+    } else {
+      SampleLocally(data, subset);
+    }
+    return true;
+  }
+
+ private:
+  // The points of one grid level bucketed by cell: the points of cell c are
+  // points[cell_offsets[c]] to points[cell_offsets[c + 1] - 1].
+  struct GridLevel {
+    int cells_per_side;
+    std::vector<int> cell_offsets;
+    std::vector<int> points;
+    // The cell and the position within points of each point.
+    std::vector<int> point_cell;
+    std::vector<int> point_position;
+  };
+
+  // Buckets the positions into the grid levels with a counting sort per level.
+  void BuildGrid(const int num_data, const bool use_positions) {
+    num_data_ = num_data;
+    global_indices_.resize(num_data_);
+    for (int i = 0; i < num_data_; i++) {
+      global_indices_[i] = i;
+    }
+    swaps_.resize(this->min_num_samples_);
+    if (!use_positions) {
+      return;
+    }
+
+    // Normalize the positions to the unit square.
+    Eigen::Vector2d min_position = (*positions_)[0];
+    Eigen::Vector2d max_position = (*positions_)[0];
+    for (const Eigen::Vector2d& position : *positions_) {
+      min_position = min_position.cwiseMin(position);
+      max_position = max_position.cwiseMax(position);
+    }
+    static const double kMinExtent = 1e-12;
+    const Eigen::Vector2d extent = (max_position - min_position).cwiseMax(
+        Eigen::Vector2d::Constant(kMinExtent));
+
+    levels_.resize(num_levels_);
+    for (int l = 0; l < num_levels_; l++) {
+      GridLevel& level = levels_[l];
+      level.cells_per_side = 1 << (num_levels_ - 1 - l);
+      const int num_cells = level.cells_per_side * level.cells_per_side;
+      level.cell_offsets.assign(num_cells + 1, 0);
+      level.points.resize(num_data_);
+      level.point_cell.resize(num_data_);
+      level.point_position.resize(num_data_);
+
+      for (int i = 0; i < num_data_; i++) {
+        const Eigen::Vector2d normalized =
+            ((*positions_)[i] - min_position).cwiseQuotient(extent);
+        const int x = std::min(
+            static_cast<int>(normalized.x() * level.cells_per_side),
+            level.cells_per_side - 1);
+        const int y = std::min(
+            static_cast<int>(normalized.y() * level.cells_per_side),
+            level.cells_per_side - 1);
+        level.point_cell[i] = y * level.cells_per_side + x;
+        level.cell_offsets[level.point_cell[i] + 1]++;
+      }
+      for (int c = 0; c < num_cells; c++) {
+        level.cell_offsets[c + 1] += level.cell_offsets[c];
+      }
+      // Use the offsets as insertion cursors and shift them back afterwards.
+      for (int i = 0; i < num_data_; i++) {
+        const int position = level.cell_offsets[level.point_cell[i]]++;
+        level.points[position] = i;
+        level.point_position[i] = position;
+      }
+      for (int c = num_cells; c > 0; c--) {
+        level.cell_offsets[c] = level.cell_offsets[c - 1];
+      }
+      level.cell_offsets[0] = 0;
+    }
+
+    // Start every center at the finest level whose cell can hold a sample. The
+    // coarsest level is a single cell, so such a level always exists.
+    point_level_.resize(num_data_);
+    point_hits_.assign(num_data_, 0);
+    for (int i = 0; i < num_data_; i++) {
+      point_level_[i] = 0;
+      while (CellSize(point_level_[i], i) < this->min_num_samples_) {
+        point_level_[i]++;
+      }
+    }
+  }
+
+  // The number of points in the cell containing point i at the given level.
+  int CellSize(const int level, const int i) const {
+    const int cell = levels_[level].point_cell[i];
+    return levels_[level].cell_offsets[cell + 1] -
+           levels_[level].cell_offsets[cell];
+  }
+
+  // Draws a sample made of a random center and m - 1 points of its cell.
+  void SampleLocally(const std::vector<Datum>& data,
+                     std::vector<Datum>* subset) {
+    std::uniform_int_distribution<int> center_distribution(0, num_data_ - 1);
+    const int center = center_distribution(rng_);
+    const int l = point_level_[center];
+    GridLevel& level = levels_[l];
+    const int cell = level.point_cell[center];
+    const int begin = level.cell_offsets[cell];
+    const int end = level.cell_offsets[cell + 1];
+
+    // Move the center to the front of its cell and draw the remaining points
+    // from the rest of the cell with a partial Fisher-Yates shuffle. The swaps
+    // are undone afterwards so that the bucketing remains valid.
+    swaps_[0] = level.point_position[center];
+    std::swap(level.points[begin], level.points[swaps_[0]]);
+    this->sample_indices_[0] = center;
+    (*subset)[0] = data[center];
+    for (int i = 1; i < this->min_num_samples_; i++) {
+      std::uniform_int_distribution<int> distribution(begin + i, end - 1);
+      swaps_[i] = distribution(rng_);
+      std::swap(level.points[begin + i], level.points[swaps_[i]]);
+      this->sample_indices_[i] = level.points[begin + i];
+      (*subset)[i] = data[level.points[begin + i]];
+    }
+    for (int i = this->min_num_samples_ - 1; i >= 0; i--) {
+      std::swap(level.points[begin + i], level.points[swaps_[i]]);
+    }
+
+    // Grow the neighbourhood of the center once its cell has been covered.
+    if (++point_hits_[center] >= end - begin && l + 1 < num_levels_) {
+      point_level_[center]++;
+      point_hits_[center] = 0;
+    }
+  }
+
+  // Draws a sample uniformly from all of the data.
+  void SampleGlobally(const std::vector<Datum>& data,
+                      std::vector<Datum>* subset) {
+    for (int i = 0; i < this->min_num_samples_; i++) {
+      std::uniform_int_distribution<int> distribution(i, num_data_ - 1);
+      std::swap(global_indices_[i], global_indices_[distribution(rng_)]);
+      this->sample_indices_[i] = global_indices_[i];
+      (*subset)[i] = data[global_indices_[i]];
+    }
+  }
+
+  // The number of grid levels, the finest one having 2^(num_levels_ - 1) cells
+  // per side.
+  const int num_levels_;
+
+  // The number of samples after which all samples are drawn globally.
+  const int num_blending_iterations_;
+
+  // The kth sample since the last reset.
+  int kth_sample_number_;
+
+  // The size of the data the grid was built for.
+  int num_data_;
+
+  // The grid levels, from the finest to the coarsest.
+  std::vector<GridLevel> levels_;
+
+  // The current level and the number of samples drawn at that level of each
+  // center.
+  std::vector<int> point_level_;
+  std::vector<int> point_hits_;
+
+  // A permutation of the data indices used for the global sampling and the
+  // swaps applied while drawing a local sample.
+  std::vector<int> global_indices_;
+  std::vector<int> swaps_;
+
+  // The 2D positions of the data. Not owned.
+  const std::vector<Eigen::Vector2d>* positions_;
+
+  // The random number generator.
+  std::mt19937 rng_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
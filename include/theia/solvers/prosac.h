@@ -11,12 +11,22 @@
 
 #include "theia/solvers/estimator.h"
 #include "theia/solvers/prosac_sampler.h"
+#include "theia/solvers/prosac_termination.h"
 #include "theia/solvers/sample_consensus_estimator.h"
 
 namespace theia {
 // Estimate a model using PROSAC. The Estimate method is inherited, but for
 // PROSAC requires the data to be in sorted order by quality (with highest
-// quality at index 0).
+// quality at index 0), unless the quality ordering is given with
+// SetQualityOrder or SetQualityScores. In that case the data is sampled through
+// the ordering and the inlier indices of the summary refer to the data as it
+// was passed to Estimate.
+//
+// In addition to the standard RANSAC bound, PROSAC terminates according to its
+// own non-randomness and maximality criteria (see prosac_termination.h), which
+// may stop the estimation much earlier when the highest quality data is mostly
+// made of inliers. Both bounds are limited by RansacParameters::min_iterations,
+// so it should be lowered accordingly to benefit from early termination.
 template <class ModelEstimator>
 class Prosac : public SampleConsensusEstimator<ModelEstimator> {
  public:
@@ -24,14 +34,81 @@ class Prosac : public SampleConsensusEstimator<ModelEstimator> {
   typedef typename ModelEstimator::Model Model;
 
   Prosac(const RansacParameters& ransac_params, const ModelEstimator& estimator)
-      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator) {}
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator),
+        termination_criterion_(ransac_params.error_thresh),
+        prosac_sampler_(nullptr) {}
   ~Prosac() {}
 
   bool Initialize() {
-    Sampler<Datum>* prosac_sampler =
-        new ProsacSampler<Datum>(this->estimator_.SampleSize());
-    return SampleConsensusEstimator<ModelEstimator>::Initialize(prosac_sampler);
+    prosac_sampler_ = new ProsacSampler<Datum>(this->estimator_.SampleSize());
+    prosac_sampler_->SetQualityOrder(&quality_order_);
+    return SampleConsensusEstimator<ModelEstimator>::Initialize(
+        prosac_sampler_);
   }
+
+  // Sets the quality ordering of the data passed to the following calls to
+  // Estimate: quality_order[i] is the index of the data point with the ith
+  // highest quality. An empty ordering means the data is sorted by quality.
+  void SetQualityOrder(const std::vector<int>& quality_order) {
+    quality_order_ = quality_order;
+    if (prosac_sampler_ != nullptr) {
+      prosac_sampler_->SetQualityOrder(&quality_order_);
+    }
+  }
+
+  // Sets the quality ordering from a quality score for each data point, where
+  // higher scores indicate better quality. Only the indices are sorted.
+  void SetQualityScores(const std::vector<double>& quality_scores) {
+    quality_order_.resize(quality_scores.size());
+    for (int i = 0; i < quality_order_.size(); i++) {
+      quality_order_[i] = i;
+    }
+    std::sort(quality_order_.begin(), quality_order_.end(),
+              [&quality_scores](const int i, const int j) {
+                return quality_scores[i] > quality_scores[j];
+              });
+    if (prosac_sampler_ != nullptr) {
+      prosac_sampler_->SetQualityOrder(&quality_order_);
+    }
+  }
+
+  // Each estimation restarts the progressive sampling from the highest quality
+  // data.
+  void Start(const std::vector<Datum>& data,
+             Model* best_model,
+             RansacSummary* summary) {
+    CHECK_NOTNULL(prosac_sampler_)->Reset();
+    SampleConsensusEstimator<ModelEstimator>::Start(data, best_model, summary);
+  }
+
+ protected:
+  // Returns the smaller of the standard RANSAC bound and the PROSAC bound.
+  int UpdateMaxIterations(const std::vector<double>& residuals,
+                          const double log_failure_prob,
+                          const int max_iterations) {
+    const int ransac_max_iterations =
+        SampleConsensusEstimator<ModelEstimator>::UpdateMaxIterations(
+            residuals, log_failure_prob, max_iterations);
+    const double prosac_max_iterations =
+        termination_criterion_.ComputeMaxIterations(
+            residuals, &quality_order_, this->estimator_.SampleSize(),
+            log_failure_prob);
+    VLOG(3) << "PROSAC max number of iterations = " << prosac_max_iterations;
+    return std::min(
+        ransac_max_iterations,
+        static_cast<int>(std::max(
+            static_cast<double>(this->ransac_params_.min_iterations),
+            ceil(prosac_max_iterations))));
+  }
+
+ private:
+  ProsacTerminationCriterion termination_criterion_;
+
+  // The quality ordering of the data, empty if the data is sorted by quality.
+  std::vector<int> quality_order_;
+
+  // The sampler set up in Initialize. Owned by the base class.
+  ProsacSampler<Datum>* prosac_sampler_;
 };
 }  // namespace theia
 
@@ -5,6 +5,7 @@
 #define THEIA_SOLVERS_PROSAC_SAMPLER_H_
 
 #include <glog/logging.h>
+#include <math.h>
 #include <stdlib.h>
 #include <algorithm>
 #include <chrono>
@@ -12,99 +13,183 @@
 #include <vector>
 
 #include "theia/solvers/sampler.h"
-#include "theia/util/random.h"
 
 namespace theia {
 // Prosac sampler used for PROSAC implemented according to "Matching with PROSAC
 // - Progressive Sampling Consensus" by Chum and Matas.
+//
+// The growth function is kept as state and advanced incrementally as samples
+// are drawn, so that drawing the kth sample costs O(m) rather than O(k). The
+// state is bound to the size of the data and is reset automatically when the
+// data size changes, or explicitly with Reset() (e.g. between frames).
+//
+// The data is either sorted by quality, or drawn through a quality ordering
+// (see SetQualityOrder) so that the data itself does not have to be reordered.
 template <class Datum> class ProsacSampler : public Sampler<Datum> {
  public:
   explicit ProsacSampler(const int min_num_samples)
-      : Sampler<Datum>(min_num_samples) {}
+      : Sampler<Datum>(min_num_samples),
+        ransac_convergence_iterations_(20000),
+        kth_sample_number_(1),
+        num_data_(0),
+        quality_order_(nullptr) {}
   ~ProsacSampler() {}
 
   bool Initialize() {
     ransac_convergence_iterations_ = 20000;
-    kth_sample_number_ = 1;
-    InitRandomGenerator();
+    rng_.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    Reset();
     return true;
   }
 
+  // Restarts the progressive sampling from the first sample. The growth
+  // function is recomputed on the next call to Sample.
+  void Reset() {
+    kth_sample_number_ = 1;
+    num_data_ = 0;
+  }
+
+  // Re-seeds the random number generator, e.g. to make the samples of a frame
+  // reproducible.
+  void SetSeed(const unsigned seed) { rng_.seed(seed); }
+
+  // Sets the order in which the data is sampled: (*quality_order)[i] is the
+  // index of the data point with the ith highest quality. The ordering is not
+  // copied and must outlive the sampler. Pass nullptr or an empty ordering if
+  // the data itself is sorted by quality.
+  void SetQualityOrder(const std::vector<int>* quality_order) {
+    quality_order_ = quality_order;
+    num_data_ = 0;
+  }
+
   // Set the sample such that you are sampling the kth prosac sample (Eq. 6).
-  void SetSampleNumber(int k) { kth_sample_number_ = k; }
+  void SetSampleNumber(int k) {
+    CHECK_GT(k, 0);
+    // The growth function can only be advanced, so rewinding restarts it.
+    if (k < kth_sample_number_) {
+      num_data_ = 0;
+    }
+    kth_sample_number_ = k;
+  }
 
   // Samples the input variable data and fills the vector subset with the prosac
   // samples.
-  // NOTE: This assumes that data is in sorted order by quality where data[i] is
-  // of higher quality than data[j] for all i < j.
+  // NOTE: Unless a quality ordering is set, this assumes that data is in sorted
+  // order by quality where data[i] is of higher quality than data[j] for all
+  // i < j.
   bool Sample(const std::vector<Datum>& data, std::vector<Datum>* subset) {
-    // Set t_n according to the PROSAC paper's recommendation.
-    double t_n = ransac_convergence_iterations_;
-    int n = this->min_num_samples_;
-    // From Equations leading up to Eq 3 in Chum et al.
-    for (int i = 0; i < this->min_num_samples_; i++) {
-      t_n *= static_cast<double>(n - i) / (data.size() - i);
+    CHECK_GE(data.size(), this->min_num_samples_);
+    const bool use_quality_order =
+        quality_order_ != nullptr && !quality_order_->empty();
+    if (use_quality_order) {
+      CHECK_EQ(quality_order_->size(), data.size())
+          << "The quality ordering does not match the size of the data!";
+    }
+    if (num_data_ != data.size()) {
+      InitializeGrowthFunction(data.size());
     }
 
-    double t_n_prime = 1.0;
-    // Choose min n such that T_n_prime >= t (Eq. 5).
-    for (int t = 1; t <= kth_sample_number_; t++) {
-      if (t > t_n_prime && n < data.size()) {
-        double t_n_plus1 =
-            (t_n * (n + 1.0)) / (n + 1.0 - this->min_num_samples_);
-        t_n_prime += ceil(t_n_plus1 - t_n);
-        t_n = t_n_plus1;
-        n++;
-      }
+    // Choose min n such that T_n_prime >= t (Eq. 5). Each step of the growth
+    // function raises T_n_prime by at least one, so this is a single step per
+    // sample once the state has caught up with kth_sample_number_.
+    while (kth_sample_number_ > t_n_prime_ && n_ < num_data_) {
+      const double t_n_plus1 =
+          (t_n_ * (n_ + 1.0)) / (n_ + 1.0 - this->min_num_samples_);
+      t_n_prime_ += ceil(t_n_plus1 - t_n_);
+      t_n_ = t_n_plus1;
+      n_++;
     }
-    subset->reserve(this->min_num_samples_);
-    if (t_n_prime < kth_sample_number_) {
+
+    subset->resize(this->min_num_samples_);
+    this->sample_indices_.resize(this->min_num_samples_);
+    if (t_n_prime_ < kth_sample_number_) {
       // Randomly sample m data points from the top n data points.
-      std::vector<int> random_numbers;
-      for (int i = 0; i < this->min_num_samples_; i++) {
-        // Generate a random number that has not already been used.
-        int rand_number;
-        while (std::find(random_numbers.begin(), random_numbers.end(),
-                         (rand_number = RandInt(0, n - 1))) !=
-               random_numbers.end()) {
-        }
-
-        random_numbers.push_back(rand_number);
-
-        // Push the *unique* random index back.
-        subset->push_back(data[rand_number]);
-      }
+      SampleUniqueIndices(data, this->min_num_samples_, n_, subset);
     } else {
-      std::vector<int> random_numbers;
       // Randomly sample m-1 data points from the top n-1 data points.
-      for (int i = 0; i < this->min_num_samples_ - 1; i++) {
-        // Generate a random number that has not already been used.
-        int rand_number;
-        while (std::find(random_numbers.begin(), random_numbers.end(),
-                         (rand_number = RandInt(0, n - 2))) !=
-               random_numbers.end()) {
-        }
-        random_numbers.push_back(rand_number);
-
-        // Push the *unique* random index back.
-        subset->push_back(data[rand_number]);
-      }
+      SampleUniqueIndices(data, this->min_num_samples_ - 1, n_ - 1, subset);
       // Make the last point from the nth position.
-      subset->push_back(data[n]);
+      this->sample_indices_.back() =
+          use_quality_order ? (*quality_order_)[n_ - 1] : n_ - 1;
+      subset->back() = data[this->sample_indices_.back()];
     }
-    CHECK_EQ(subset->size(), this->min_num_samples_)
-        << "Prosac subset is incorrect "
-        << "size!";
     kth_sample_number_++;
     return true;
   }
 
  private:
+  // Resets the growth function to its initial state for data of size
+  // num_data. From Equations leading up to Eq 3 in Chum et al.
+  void InitializeGrowthFunction(const int num_data) {
+    num_data_ = num_data;
+    n_ = this->min_num_samples_;
+    // Set t_n according to the PROSAC paper's recommendation.
+    t_n_ = ransac_convergence_iterations_;
+    for (int i = 0; i < this->min_num_samples_; i++) {
+      t_n_ *= static_cast<double>(n_ - i) / (num_data_ - i);
+    }
+    t_n_prime_ = 1;
+
+    // The ith entry of indices_ is the index of the data point of rank i.
+    indices_.resize(num_data_);
+    if (quality_order_ != nullptr && !quality_order_->empty()) {
+      std::copy(quality_order_->begin(), quality_order_->end(),
+                indices_.begin());
+    } else {
+      for (int i = 0; i < num_data_; i++) {
+        indices_[i] = i;
+      }
+    }
+    swaps_.resize(this->min_num_samples_);
+  }
+
+  // Draws num_samples unique data points among the num_candidates of highest
+  // quality with a partial Fisher-Yates shuffle of indices_ and writes them to
+  // the front of subset. The swaps are undone afterwards so that indices_
+  // remains sorted by quality, which makes each draw O(num_samples).
+  void SampleUniqueIndices(const std::vector<Datum>& data,
+                           const int num_samples,
+                           const int num_candidates,
+                           std::vector<Datum>* subset) {
+    for (int i = 0; i < num_samples; i++) {
+      std::uniform_int_distribution<int> distribution(i, num_candidates - 1);
+      swaps_[i] = distribution(rng_);
+      std::swap(indices_[i], indices_[swaps_[i]]);
+      this->sample_indices_[i] = indices_[i];
+      (*subset)[i] = data[indices_[i]];
+    }
+    for (int i = num_samples - 1; i >= 0; i--) {
+      std::swap(indices_[i], indices_[swaps_[i]]);
+    }
+  }
+
   // Number of iterations of PROSAC before it just acts like ransac.
   int ransac_convergence_iterations_;
 
   // The kth sample of prosac sampling.
   int kth_sample_number_;
+
+  // The size of the data the growth function was initialized for.
+  int num_data_;
+
+  // The size of the current hypothesis generation set, i.e. samples are drawn
+  // from the top n_ data points.
+  int n_;
+
+  // T_n and T'_n of the growth function (Eq. 3 and 4).
+  double t_n_;
+  int t_n_prime_;
+
+  // The data indices sorted by quality and the swaps applied to them while
+  // drawing a sample.
+  std::vector<int> indices_;
+  std::vector<int> swaps_;
+
+  // The optional quality ordering of the data. Not owned.
+  const std::vector<int>* quality_order_;
+
+  // The random number generator.
+  std::mt19937 rng_;
 };
 
 }  // namespace theia
@@ -0,0 +1,115 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_PROSAC_TERMINATION_H_
+#define THEIA_SOLVERS_PROSAC_TERMINATION_H_
+
+#include <glog/logging.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace theia {
+// The termination criteria of PROSAC from "Matching with PROSAC - Progressive
+// Sampling Consensus" by Chum and Matas (Section 2.2). Given the residuals of
+// the best model found so far, the inliers within each prefix U_n of the data
+// (sorted by quality) are counted. Among the prefixes whose inlier count passes
+// the non-randomness test, n* is chosen to minimize the number of samples
+// needed to guarantee, with the desired confidence, that no larger support
+// exists in U_n* (maximality). That number of samples is the PROSAC bound on
+// the number of iterations.
+class ProsacTerminationCriterion {
+ public:
+  // Params:
+  //   error_thresh: The error threshold for a data point to be an inlier.
+  //   random_inlier_probability: The probability (beta in the paper) that a
+  //     data point is consistent with an incorrect model.
+  ProsacTerminationCriterion(const double error_thresh,
+                             const double random_inlier_probability = 0.05)
+      : error_thresh_(error_thresh),
+        random_inlier_probability_(random_inlier_probability),
+        min_sample_size_(0),
+        num_data_(0) {
+    CHECK_GT(random_inlier_probability_, 0.0);
+    CHECK_LT(random_inlier_probability_, 1.0);
+  }
+
+  // Precomputes the minimal number of inliers I_n^min of each prefix U_n for
+  // data of size num_data. The non-randomness test (Eq. 7-9) uses the normal
+  // approximation of the binomial distribution of random inliers at the 5%
+  // significance level. This is called automatically by ComputeMaxIterations
+  // whenever the size of the residuals changes.
+  void Initialize(const int num_data, const int min_sample_size) {
+    // The z-score of the one-sided 5% significance level.
+    static const double kNonRandomnessZScore = 1.644854;
+
+    num_data_ = num_data;
+    min_sample_size_ = min_sample_size;
+    const double beta = random_inlier_probability_;
+    min_num_inliers_.resize(num_data_ + 1);
+    for (int n = 0; n <= num_data_; n++) {
+      const double num_tested = std::max(n - min_sample_size_, 0);
+      min_num_inliers_[n] =
+          min_sample_size_ + beta * num_tested +
+          kNonRandomnessZScore * sqrt(num_tested * beta * (1.0 - beta));
+    }
+  }
+
+  // Returns the number of samples after which PROSAC may terminate given the
+  // residuals of the best model so far, or the maximum int value if no prefix
+  // of the data passes the non-randomness test. The residuals are visited in
+  // the order given by quality_order (see ProsacSampler::SetQualityOrder), or
+  // in their own order if quality_order is null or empty.
+  double ComputeMaxIterations(const std::vector<double>& residuals,
+                              const std::vector<int>* quality_order,
+                              const int min_sample_size,
+                              const double log_failure_prob) {
+    const bool use_quality_order =
+        quality_order != nullptr && !quality_order->empty();
+    if (residuals.size() != num_data_ || min_sample_size != min_sample_size_) {
+      Initialize(residuals.size(), min_sample_size);
+    }
+
+    double max_iterations = std::numeric_limits<int>::max();
+    int num_inliers = 0;
+    for (int n = 1; n <= num_data_; n++) {
+      const int index = use_quality_order ? (*quality_order)[n - 1] : n - 1;
+      if (residuals[index] < error_thresh_) {
+        ++num_inliers;
+      }
+
+      if (n < min_sample_size_ || num_inliers < min_num_inliers_[n]) {
+        continue;
+      }
+
+      // Maximality (Eq. 10): the probability that a sample drawn from U_n
+      // contains only inliers.
+      double all_inlier_probability = 1.0;
+      for (int j = 0; j < min_sample_size_; j++) {
+        all_inlier_probability *=
+            static_cast<double>(num_inliers - j) / static_cast<double>(n - j);
+      }
+      if (all_inlier_probability >= 1.0) {
+        return 0;
+      }
+      max_iterations =
+          std::min(max_iterations,
+                   log_failure_prob / log(1.0 - all_inlier_probability));
+    }
+    return max_iterations;
+  }
+
+ private:
+  const double error_thresh_;
+  const double random_inlier_probability_;
+  int min_sample_size_;
+  int num_data_;
+
+  // I_n^min of the non-randomness test for each prefix size n.
+  std::vector<double> min_num_inliers_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_PROSAC_TERMINATION_H_
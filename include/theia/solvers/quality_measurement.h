@@ -31,6 +31,17 @@ class QualityMeasurement {
   // number of iterations.
   virtual double GetInlierRatio() const = 0;
 
+  // Resets the maximum inlier ratio returned by GetInlierRatio, so that a new
+  // estimation does not start from the inlier ratio of the previous one. This
+  // must be cheap, unlike Initialize, since it is called for every estimation.
+  virtual void ResetInlierRatio() {}
+
+  // Returns a copy of the quality measurement that may be used concurrently
+  // with this one, e.g. to score hypotheses on several threads. Returns nullptr
+  // if the measurement cannot be copied, in which case hypotheses are scored
+  // on a single thread.
+  virtual QualityMeasurement* Clone() const { return nullptr; }
+
  protected:
   double error_thresh_;
 };
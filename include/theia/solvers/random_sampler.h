@@ -30,18 +30,31 @@ template <class Datum> class RandomSampler : public Sampler<Datum> {
   // random samples.
   bool Sample(const std::vector<Datum>& data, std::vector<Datum>* subset) {
     subset->resize(this->min_num_samples_);
-    std::vector<int> random_numbers(data.size());
-    for (int i = 0; i < data.size(); i++) {
-      random_numbers[i] = i;
+    this->sample_indices_.resize(this->min_num_samples_);
+    // The index buffer is kept between calls so that sampling does not allocate
+    // memory. Any permutation of the indices is a valid starting point for the
+    // Fisher-Yates sampling, so it only needs to be reset when the size of the
+    // data changes.
+    if (random_numbers_.size() != data.size()) {
+      random_numbers_.resize(data.size());
+      for (int i = 0; i < data.size(); i++) {
+        random_numbers_[i] = i;
+      }
     }
 
     for (int i = 0; i < this->min_num_samples_; i++) {
-      std::swap(random_numbers[i], random_numbers[RandInt(i, data.size() - 1)]);
-      (*subset)[i] = data[random_numbers[i]];
+      std::swap(random_numbers_[i],
+                random_numbers_[RandInt(i, data.size() - 1)]);
+      this->sample_indices_[i] = random_numbers_[i];
+      (*subset)[i] = data[random_numbers_[i]];
     }
 
     return true;
   }
+
+ private:
+  // A permutation of the data indices used for the Fisher-Yates sampling.
+  std::vector<int> random_numbers_;
 };
 
 }  // namespace theia
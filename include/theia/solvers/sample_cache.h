@@ -0,0 +1,204 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_SAMPLE_CACHE_H_
+#define THEIA_SOLVERS_SAMPLE_CACHE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "theia/math/combination_enumerator.h"
+#include "theia/util/hash.h"
+
+namespace theia {
+// A set of the minimal samples that have already been evaluated, so that the
+// sample consensus estimators can skip repeated samples. For small datasets
+// (e.g. N = 30 to 100 with samples of 3 points) a random sampler draws the
+// same sample again quite often, and each repeat would re-run the solver and
+// re-score the data.
+//
+// The samples are stored as index tuples, sorted unless the order of the
+// sample matters to the estimator, in an open addressing hash table. The table
+// is allocated by Reset and Grow for the number of samples of the dataset, and
+// is cleared in O(1) by advancing a generation counter, so that inserting
+// samples and resetting the cache for data of the same size never allocates.
+// The cache is only enabled if the data is small enough for repeats to be
+// likely and the sample fits in a tuple, and it stops growing after
+// max_num_entries samples so that its memory stays bounded.
+class SampleCache {
+ public:
+  // The largest sample size that can be cached.
+  static const int kMaxSampleSize = 8;
+
+  // Params:
+  //   max_num_data:  The cache is disabled for datasets larger than this.
+  //   max_num_entries:  The maximum number of samples kept in the cache.
+  explicit SampleCache(const int max_num_data = 200,
+                       const int max_num_entries = 1 << 15)
+      : max_num_data_(max_num_data),
+        max_num_entries_(max_num_entries),
+        enabled_(false),
+        ordered_(false),
+        sample_size_(0),
+        num_samples_(0),
+        num_entries_(0),
+        generation_(1),
+        log_num_slots_(0) {}
+
+  // Clears the cache for a new dataset and decides whether it is enabled. If
+  // ordered is set, samples of the same data in a different order are
+  // different samples, e.g. if the estimator uses the last point of a sample
+  // differently from the others (see Estimator::SampleOrderMatters).
+  void Reset(const int num_data,
+             const int sample_size,
+             const bool ordered = false) {
+    Clear();
+    enabled_ = num_data <= max_num_data_ && sample_size <= kMaxSampleSize;
+    ordered_ = ordered;
+    sample_size_ = sample_size;
+    if (!enabled_) {
+      return;
+    }
+    num_samples_ = NumSamples(num_data);
+    ReserveSlots();
+  }
+
+  // Grows the dataset to num_data data points by appending data, e.g. in
+  // IncrementalRansac. The cached samples stay valid since the indices of the
+  // previous data do not change. The cache is disabled once the data is too
+  // large.
+  void Grow(const int num_data) {
+    if (!enabled_ || num_data > max_num_data_) {
+      enabled_ = false;
+      Clear();
+      return;
+    }
+    num_samples_ = NumSamples(num_data);
+    ReserveSlots();
+  }
+
+  // Inserts the sample given by its indices into the data. Returns false if
+  // the sample is already in the cache, and true otherwise (including when the
+  // cache is disabled, full, or the indices are unknown).
+  bool Insert(const std::vector<int>& sample_indices) {
+    if (!enabled_ || sample_indices.empty() ||
+        sample_indices.size() > kMaxSampleSize) {
+      return true;
+    }
+
+    SampleKey key;
+    key.fill(-1);
+    std::copy(sample_indices.begin(), sample_indices.end(), key.begin());
+    if (!ordered_) {
+      std::sort(key.begin(), key.begin() + sample_indices.size());
+    }
+
+    // Linear probing. The table has at least twice as many slots as entries,
+    // so there always is an empty slot.
+    const uint64_t mask = slots_.size() - 1;
+    uint64_t slot = Slot(key);
+    while (generations_[slot] == generation_) {
+      if (slots_[slot] == key) {
+        return false;
+      }
+      slot = (slot + 1) & mask;
+    }
+    if (num_entries_ < max_num_entries_) {
+      slots_[slot] = key;
+      generations_[slot] = generation_;
+      num_entries_++;
+    }
+    return true;
+  }
+
+  // Returns true if every possible sample of the dataset is in the cache.
+  bool Exhausted() const { return enabled_ && num_entries_ >= num_samples_; }
+
+ private:
+  typedef std::array<int, kMaxSampleSize> SampleKey;
+
+  // Empties the cache. The slots of earlier generations are empty.
+  void Clear() {
+    num_entries_ = 0;
+    if (++generation_ == 0) {
+      std::fill(generations_.begin(), generations_.end(), 0);
+      generation_ = 1;
+    }
+  }
+
+  // The number of distinct samples of num_data data points.
+  double NumSamples(const int num_data) const {
+    double num_samples =
+        CombinationEnumerator::NumCombinations(num_data, sample_size_);
+    if (ordered_) {
+      for (int i = 2; i <= sample_size_; i++) {
+        num_samples *= i;
+      }
+    }
+    return num_samples;
+  }
+
+  // Makes sure that the table has at least twice as many slots as the number
+  // of entries it may hold, rehashing the current entries if it grows.
+  void ReserveSlots() {
+    const double max_num_entries =
+        std::min<double>(num_samples_, max_num_entries_);
+    int log_num_slots = 4;
+    while ((uint64_t(1) << log_num_slots) < 2 * max_num_entries) {
+      log_num_slots++;
+    }
+    if (log_num_slots <= log_num_slots_) {
+      return;
+    }
+
+    std::vector<SampleKey> slots(uint64_t(1) << log_num_slots);
+    std::vector<uint32_t> generations(slots.size(), 0);
+    slots_.swap(slots);
+    generations_.swap(generations);
+    log_num_slots_ = log_num_slots;
+    const uint64_t mask = slots_.size() - 1;
+    for (int i = 0; i < slots.size(); i++) {
+      if (generations[i] != generation_) {
+        continue;
+      }
+      uint64_t slot = Slot(slots[i]);
+      while (generations_[slot] == generation_) {
+        slot = (slot + 1) & mask;
+      }
+      slots_[slot] = slots[i];
+      generations_[slot] = generation_;
+    }
+  }
+
+  // The first slot probed for the key, from the high bits of its hash
+  // multiplied by the golden ratio (Fibonacci hashing).
+  uint64_t Slot(const SampleKey& key) const {
+    static const uint64_t kGoldenRatio = 0x9e3779b97f4a7c15ULL;
+    return (static_cast<uint64_t>(std::hash<SampleKey>()(key)) *
+            kGoldenRatio) >> (64 - log_num_slots_);
+  }
+
+  const int max_num_data_;
+  const int max_num_entries_;
+  bool enabled_;
+  bool ordered_;
+  int sample_size_;
+
+  // The number of distinct samples of the current dataset.
+  double num_samples_;
+  int num_entries_;
+
+  // The slots of the hash table, which hold a sample if their generation is
+  // the current generation.
+  std::vector<SampleKey> slots_;
+  std::vector<uint32_t> generations_;
+  uint32_t generation_;
+  int log_num_slots_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_SAMPLE_CACHE_H_
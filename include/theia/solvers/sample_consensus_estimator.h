@@ -5,17 +5,29 @@
 #define THEIA_SOLVERS_SAMPLE_CONSENSUS_ESTIMATOR_H_
 
 #include <glog/logging.h>
+#ifdef THEIA_USE_OPENMP
+#include <omp.h>
+#endif
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <vector>
 
+#include "theia/math/combination_enumerator.h"
+#include "theia/solvers/estimation_workspace.h"
 #include "theia/solvers/estimator.h"
 #include "theia/solvers/inlier_support.h"
+#include "theia/solvers/magsac_quality_measurement.h"
 #include "theia/solvers/mle_quality_measurement.h"
+#include "theia/solvers/mlesac_quality_measurement.h"
+#include "theia/solvers/model_prior.h"
 #include "theia/solvers/quality_measurement.h"
+#include "theia/solvers/sample_cache.h"
 #include "theia/solvers/sampler.h"
+#include "theia/util/random.h"
 
 namespace theia {
 
@@ -31,10 +43,15 @@ struct RansacParameters {
         min_iterations(100),
         max_iterations(std::numeric_limits<int>::max()),
         use_mle(false),
-        use_Tdd_test(false) {}
+        use_mlesac(false),
+        use_magsac(false),
+        use_Tdd_test(false),
+        use_sample_cache(false),
+        use_exhaustive_enumeration(false) {}
 
   // Error threshold to determin inliers for RANSAC (e.g., squared reprojection
   // error). This is what will be used by the estimator to determine inliers.
+  // With use_magsac, this is the maximum threshold instead.
   double error_thresh;
 
   // The failure probability of RANSAC. Set to 0.01 means that RANSAC has a 1%
@@ -66,6 +83,18 @@ struct RansacParameters {
   // and outliers count as a constant penalty.
   bool use_mle;
 
+  // Instead of the standard inlier count, use the MLESAC likelihood, which
+  // estimates the inlier ratio of each model with EM over a mixture of
+  // chi-squared (exponential) inliers and uniform outliers (see
+  // mlesac_quality_measurement.h). Takes precedence over use_mle.
+  bool use_mlesac;
+
+  // Instead of the standard inlier count, use the MAGSAC++ quality, which
+  // marginalizes the loss over the noise scale so that error_thresh only needs
+  // to be a loose upper bound (see magsac_quality_measurement.h). Takes
+  // precedence over use_mlesac and use_mle.
+  bool use_magsac;
+
   // Whether to use the T_{d,d}, with d=1, test proposed in
   // Chum, O. and Matas, J.: Randomized RANSAC and T(d,d) test, BMVC 2002.
   // After computing the pose, RANSAC selects one match at random and evaluates
@@ -73,21 +102,77 @@ struct RansacParameters {
   // is rejected. Notice that if the pose solver returns multiple poses, then
   // at most one pose is correct. If the selected match is correct, then only
   // the correct pose will pass the test. Per default, the test is disabled.
-  //
-  // NOTE: Not currently implemented!
+  // Rejected poses are counted in RansacSummary::num_rejected_models.
   bool use_Tdd_test;
+
+  // Skip samples that have already been evaluated, which is worthwhile for
+  // small datasets where the sampler often repeats itself (see
+  // sample_cache.h). Repeated samples do not count as iterations, unless many
+  // are drawn in a row, which happens when the sampler can only draw a subset
+  // of the samples (e.g. NAPSAC neighborhoods or zero-weight data). The cache
+  // is disabled automatically for large datasets.
+  bool use_sample_cache;
+
+  // Evaluate every minimal sample instead of sampling randomly when there are
+  // no more minimal samples than the maximum number of iterations (as given by
+  // max_iterations or min_inlier_ratio). The samples are enumerated in a fixed
+  // order and split across threads, and the best model over all of them is
+  // returned, so the result is optimal and deterministic. The T(1,1) test and
+  // the sample cache are not used in this mode. Unlike random sampling, the
+  // enumeration does not stop early on clean data, e.g. it evaluates all 2925
+  // samples of 27 points instead of about min_iterations samples, so it is
+  // disabled by default.
+  bool use_exhaustive_enumeration;
 };
 
 // A struct to hold useful outputs of Ransac-like methods.
 struct RansacSummary {
+  RansacSummary()
+      : num_iterations(0),
+        confidence(0.0),
+        num_rejected_samples(0),
+        num_rejected_models(0),
+        num_prior_rejected_models(0),
+        num_duplicate_samples(0),
+        cancelled(false) {}
+
   // Contains the indices of all inliers.
   std::vector<int> inliers;
 
+  // Whether each data point is an inlier, i.e. inlier_mask[i] is true if i is
+  // in inliers.
+  std::vector<bool> inlier_mask;
+
+  // The residuals of all data points w.r.t. the best model. Empty if no model
+  // could be estimated.
+  std::vector<double> residuals;
+
   // The number of iterations performed before stopping RANSAC.
   int num_iterations;
 
   // The confidence in the solution.
   double confidence;
+
+  // The number of samples rejected by Estimator::ValidSample before a model
+  // was estimated from them. These samples count as iterations.
+  int num_rejected_samples;
+
+  // The number of models rejected before scoring them on all of the data,
+  // either by Estimator::ValidModel, Estimator::ValidModelForSample or the
+  // T(1,1) test.
+  int num_rejected_models;
+
+  // The number of models rejected because they are inconsistent with the model
+  // prior (see SampleConsensusEstimator::SetModelPrior).
+  int num_prior_rejected_models;
+
+  // The number of samples skipped because they had already been evaluated
+  // (see RansacParameters::use_sample_cache).
+  int num_duplicate_samples;
+
+  // Whether the estimation was stopped early through the cancellation flag
+  // (see SampleConsensusEstimator::SetCancellationFlag).
+  bool cancelled;
 };
 
 template <class ModelEstimator> class SampleConsensusEstimator {
@@ -95,6 +180,12 @@ template <class ModelEstimator> class SampleConsensusEstimator {
   typedef typename ModelEstimator::Datum Datum;
   typedef typename ModelEstimator::Model Model;
 
+  // Called with the new best model, its inlier ratio and the confidence so far
+  // whenever the best model improves.
+  typedef std::function<void(const Model& model,
+                             const double inlier_ratio,
+                             const double confidence)> ProgressCallback;
+
   SampleConsensusEstimator(const RansacParameters& ransac_params,
                            const ModelEstimator& estimator);
 
@@ -114,22 +205,151 @@ template <class ModelEstimator> class SampleConsensusEstimator {
                         Model* best_model,
                         RansacSummary* summary);
 
+  // Same as Estimate, but the initial models are scored on the data before any
+  // sample is drawn, e.g. the pose of the previous frame or a motion-model
+  // prediction when tracking. The best initial model sets the initial best
+  // cost and inlier ratio, and thus the maximum number of iterations, so that
+  // a good initial model lets the estimation stop after min_iterations. It is
+  // returned if no sampled model is better. Initial models that are
+  // inconsistent with the model prior (see SetModelPrior) are not scored and
+  // count as RansacSummary::num_prior_rejected_models. Estimators that
+  // override Estimate without calling the one of this class (e.g. Arrsac)
+  // ignore the initial models.
+  bool EstimateWithInitialModels(const std::vector<Datum>& data,
+                                 const std::vector<Model>& initial_models,
+                                 Model* best_model,
+                                 RansacSummary* summary);
+
+  // Resumable estimation for callers that cannot block for a whole run, e.g.
+  // a cooperative scheduler. Start sets up the estimation of a model from the
+  // data (including scoring the initial models of EstimateWithInitialModels),
+  // and each call to Step runs at most num_iterations iterations. Step returns
+  // true once the estimation is finished, at which point best_model and the
+  // summary are the same as after Estimate. Between steps, best_model holds
+  // the best model so far if HasModel() is true, and Confidence() gives the
+  // confidence so far. data, best_model and summary must outlive the
+  // estimation.
+  //
+  // Exhaustive enumeration (see RansacParameters::use_exhaustive_enumeration)
+  // is only used by Estimate. Estimators that override Estimate to change the
+  // estimation (Arrsac, AcRansac) must be run with Estimate.
+  virtual void Start(const std::vector<Datum>& data,
+                     Model* best_model,
+                     RansacSummary* summary);
+  bool Step(const int num_iterations);
+
+  // Returns true if a model has been found since the last call to Start.
+  bool HasModel() const {
+    return state_.summary != nullptr && !state_.summary->residuals.empty();
+  }
+
+  // The confidence in the best model found since the last call to Start, which
+  // is O(N).
+  double Confidence() const;
+
+  // Sets a callback that is called whenever the best model improves during the
+  // following estimations, e.g. to act on a good enough model before the
+  // estimation terminates. It is called from the thread running the
+  // estimation. During exhaustive enumeration on several threads, it is only
+  // called once all of the samples have been evaluated. Arrsac calls it for
+  // every initial hypothesis with a larger support and once for its final
+  // model.
+  void SetProgressCallback(const ProgressCallback& progress_callback) {
+    progress_callback_ = progress_callback;
+  }
+
+  // Sets a flag that is checked at every iteration of the following
+  // estimations, which stop as soon as it is set (e.g. from another thread).
+  // A cancelled estimation returns false, but best_model and the summary hold
+  // the best model found until then, and RansacSummary::cancelled is set. The
+  // flag is not copied and must outlive its use, and nullptr removes it.
+  void SetCancellationFlag(const std::atomic<bool>* cancellation_flag) {
+    cancellation_flag_ = cancellation_flag;
+  }
+
+  // Sets a prior on the model, e.g. the pose predicted from odometry, that is
+  // used by the following calls to Estimate. Sampled models that are
+  // inconsistent with the prior are rejected before they are scored on the
+  // data, and so are inconsistent initial models (see
+  // EstimateWithInitialModels). The prior is not copied and must outlive its
+  // use, and nullptr removes it.
+  void SetModelPrior(const ModelPrior<Model>* model_prior) {
+    model_prior_ = model_prior;
+  }
+
  protected:
   // This method is called from derived classes to set up the sampling scheme
   // and the method for computing inliers. It must be called by derived classes
   // unless they override the Estimate(...) method. The method for computing
-  // inliers (standar inlier support or MLE) is determined by the ransac params.
+  // inliers (standar inlier support, MLE or MAGSAC++) is determined by the
+  // ransac params.
   //
   // sampler: The class that instantiates the sampling strategy for this
   //   particular type of sampling consensus.
   bool Initialize(Sampler<Datum>* sampler);
 
+  // Evaluates all num_combinations minimal samples of the data, in parallel if
+  // OpenMP is enabled and the quality measurement can be cloned. Used by
+  // Estimate when there are few enough samples (see
+  // RansacParameters::use_exhaustive_enumeration). best_model, best_cost and
+  // the residuals of the summary are only replaced by a sampled model with a
+  // lower cost than best_cost. On a single thread, no memory is allocated.
+  void EstimateExhaustively(const std::vector<Datum>& data,
+                            const int num_combinations,
+                            double* best_cost,
+                            Model* best_model,
+                            RansacSummary* summary);
+
+  // Estimates the models of the minimal sample in workspace_.data_subset and
+  // scores the valid ones on the data, after the T(1,1) test if use_tdd_test
+  // is set and enabled in the parameters. A model with a lower cost than
+  // best_cost replaces best_model and best_cost, and its residuals are swapped
+  // into best_residuals. Rejected samples and models are counted in the
+  // summary. Returns true if a better model was found.
+  bool EvaluateSample(const std::vector<Datum>& data,
+                      const bool use_tdd_test,
+                      Model* best_model,
+                      double* best_cost,
+                      std::vector<double>* best_residuals,
+                      RansacSummary* summary);
+
+  // Fills the inliers and the inlier mask of the summary from the residuals of
+  // the summary, which must have been set to the residuals of the best model.
+  void SetInliersFromResiduals(const double error_thresh,
+                               RansacSummary* summary) const;
+
   // Computes the maximum number of iterations required to ensure the inlier
   // ratio is the best with a probability corresponding to log_failure_prob.
   int ComputeMaxIterations(const double min_sample_size,
                            const double inlier_ratio,
                            const double log_failure_prob) const;
 
+  // Called whenever a new best model is found with the residuals of that model.
+  // Returns the new maximum number of iterations, which must not be larger
+  // than max_iterations. By default, this is the number of iterations
+  // needed to reach the inlier ratio of the quality measurement with the
+  // desired confidence (see ComputeMaxIterations).
+  virtual int UpdateMaxIterations(const std::vector<double>& residuals,
+                                  const double log_failure_prob,
+                                  const int max_iterations);
+
+  // Calls the progress callback, if any, for a new best model. Estimators that
+  // override Estimate without calling Start (e.g. Arrsac) report their
+  // progress with this method.
+  void ReportProgress(const Model& model,
+                      const double inlier_ratio,
+                      const double confidence) const {
+    if (progress_callback_) {
+      progress_callback_(model, inlier_ratio, confidence);
+    }
+  }
+
+  // Returns true if the cancellation flag is set.
+  bool Cancelled() const {
+    return cancellation_flag_ != nullptr &&
+           cancellation_flag_->load(std::memory_order_relaxed);
+  }
+
   // The sampling strategy.
   std::unique_ptr<Sampler<Datum> > sampler_;
 
@@ -141,6 +361,81 @@ template <class ModelEstimator> class SampleConsensusEstimator {
 
   // Estimator to use for generating models.
   const ModelEstimator& estimator_;
+
+  // Scratch buffers reused across iterations and calls to Estimate.
+  EstimationWorkspace<Datum, Model> workspace_;
+
+  // The samples evaluated so far if use_sample_cache is set.
+  SampleCache sample_cache_;
+
+  // The prior on the model, or null. Not owned.
+  const ModelPrior<Model>* model_prior_;
+
+  // The number of duplicate samples in a row after which the following
+  // duplicates count as iterations, so that a sampler that never draws some of
+  // the samples cannot keep the estimation from terminating.
+  static const int kMaxConsecutiveDuplicateSamples = 100;
+
+ private:
+  // The part of EstimateExhaustively run on num_threads threads, each of which
+  // scores a range of the samples with its own quality measurement.
+  void EstimateExhaustivelyInParallel(
+      const std::vector<Datum>& data,
+      const int num_combinations,
+      const int num_threads,
+      std::vector<std::unique_ptr<QualityMeasurement> >* quality_measurements,
+      double* best_cost,
+      Model* best_model,
+      RansacSummary* summary);
+
+  // Calls the progress callback, if any, for the current best model.
+  void ReportProgress();
+
+  // The callback reporting improvements of the best model, or empty.
+  ProgressCallback progress_callback_;
+
+  // The flag to stop the estimation early, or null. Not owned.
+  const std::atomic<bool>* cancellation_flag_;
+
+  // The state of the estimation started by the last call to Start, which is
+  // advanced by Step. The pointers are not owned.
+  struct EstimationState {
+    EstimationState()
+        : data(nullptr),
+          best_model(nullptr),
+          summary(nullptr),
+          best_cost(std::numeric_limits<double>::max()),
+          log_failure_prob(0.0),
+          max_iterations(0),
+          num_consecutive_duplicate_samples(0),
+          finished(true) {}
+    const std::vector<Datum>* data;
+    Model* best_model;
+    RansacSummary* summary;
+    double best_cost;
+    double log_failure_prob;
+    int max_iterations;
+    int num_consecutive_duplicate_samples;
+    bool finished;
+  };
+
+  // The number of inliers of the best model found since the last call to
+  // Start.
+  int NumInliers() const;
+
+  // The confidence of a model with num_inliers inliers after the iterations
+  // run so far.
+  double ComputeConfidence(const int num_inliers) const;
+
+  // Sets the inliers and the confidence of the summary once the estimation
+  // has finished.
+  void Finish();
+
+  // The initial models of the current call to EstimateWithInitialModels, or
+  // null. Not owned.
+  const std::vector<Model>* initial_models_;
+
+  EstimationState state_;
 };
 
 // --------------------------- Implementation --------------------------------//
@@ -148,7 +443,11 @@ template <class ModelEstimator> class SampleConsensusEstimator {
 template <class ModelEstimator>
 SampleConsensusEstimator<ModelEstimator>::SampleConsensusEstimator(
     const RansacParameters& ransac_params, const ModelEstimator& estimator)
-    : ransac_params_(ransac_params), estimator_(estimator) {
+    : ransac_params_(ransac_params),
+      estimator_(estimator),
+      model_prior_(nullptr),
+      cancellation_flag_(nullptr),
+      initial_models_(nullptr) {
   CHECK_GT(ransac_params.error_thresh, 0)
       << "Error threshold must be set to greater than zero";
   CHECK_LE(ransac_params.min_inlier_ratio, 1.0);
@@ -167,7 +466,13 @@ bool SampleConsensusEstimator<ModelEstimator>::Initialize(
     return false;
   }
 
-  if (ransac_params_.use_mle) {
+  if (ransac_params_.use_magsac) {
+    quality_measurement_.reset(
+        new MagsacQualityMeasurement(ransac_params_.error_thresh));
+  } else if (ransac_params_.use_mlesac) {
+    quality_measurement_.reset(
+        new MlesacQualityMeasurement(ransac_params_.error_thresh));
+  } else if (ransac_params_.use_mle) {
     quality_measurement_.reset(
         new MLEQualityMeasurement(ransac_params_.error_thresh));
   } else {
@@ -177,6 +482,182 @@ bool SampleConsensusEstimator<ModelEstimator>::Initialize(
   return quality_measurement_->Initialize();
 }
 
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::SetInliersFromResiduals(
+    const double error_thresh, RansacSummary* summary) const {
+  const std::vector<double>& residuals = summary->residuals;
+  summary->inliers.clear();
+  summary->inliers.reserve(residuals.size());
+  summary->inlier_mask.assign(residuals.size(), false);
+  for (int i = 0; i < residuals.size(); i++) {
+    if (residuals[i] < error_thresh) {
+      summary->inliers.push_back(i);
+      summary->inlier_mask[i] = true;
+    }
+  }
+}
+
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::EstimateExhaustively(
+    const std::vector<Datum>& data,
+    const int num_combinations,
+    double* best_cost,
+    Model* best_model,
+    RansacSummary* summary) {
+  const int sample_size = estimator_.SampleSize();
+  int num_threads = 1;
+#ifdef THEIA_USE_OPENMP
+  num_threads = std::max(1, std::min(omp_get_max_threads(), num_combinations));
+#endif
+  // Each thread scores the hypotheses with its own copy of the quality
+  // measurement.
+  std::vector<std::unique_ptr<QualityMeasurement> > quality_measurements;
+  for (int t = 0; t < num_threads && num_threads > 1; t++) {
+    quality_measurements.emplace_back(quality_measurement_->Clone());
+    if (quality_measurements.back() == nullptr) {
+      num_threads = 1;
+    }
+  }
+
+  if (num_threads == 1) {
+    // The samples are scored with the buffers of the workspace and the
+    // residuals of the best model are kept in the summary, so that no memory
+    // is allocated.
+    CombinationEnumerator& combinations = workspace_.combinations;
+    combinations.Reset(data.size(), sample_size);
+    std::vector<Datum>& data_subset = workspace_.data_subset;
+    data_subset.resize(sample_size);
+    for (int rank = 0; rank < num_combinations && !Cancelled();
+         rank++, combinations.Next()) {
+      summary->num_iterations++;
+      for (int i = 0; i < sample_size; i++) {
+        data_subset[i] = data[combinations.Indices()[i]];
+      }
+      if (EvaluateSample(data, false, best_model, best_cost,
+                         &summary->residuals, summary)) {
+        ReportProgress();
+      }
+    }
+  } else {
+    EstimateExhaustivelyInParallel(data, num_combinations, num_threads,
+                                   &quality_measurements, best_cost,
+                                   best_model, summary);
+  }
+
+  // Only the samples visited before a cancellation count as iterations.
+  summary->cancelled = summary->num_iterations < num_combinations;
+  SetInliersFromResiduals(ransac_params_.error_thresh, summary);
+  // Once every sample has been evaluated, the best model cannot be missed.
+  summary->confidence = summary->cancelled
+                            ? ComputeConfidence(summary->inliers.size())
+                            : 1.0;
+}
+
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::EstimateExhaustivelyInParallel(
+    const std::vector<Datum>& data,
+    const int num_combinations,
+    const int num_threads,
+    std::vector<std::unique_ptr<QualityMeasurement> >* quality_measurements,
+    double* best_cost,
+    Model* best_model,
+    RansacSummary* summary) {
+  // The state of the search over one range of samples.
+  struct SearchState {
+    SearchState()
+        : best_cost(std::numeric_limits<double>::max()),
+          num_iterations(0),
+          num_rejected_samples(0),
+          num_rejected_models(0),
+          num_prior_rejected_models(0) {}
+    double best_cost;
+    Model best_model;
+    std::vector<double> best_residuals;
+    int num_iterations;
+    int num_rejected_samples;
+    int num_rejected_models;
+    int num_prior_rejected_models;
+  };
+
+  const int sample_size = estimator_.SampleSize();
+  std::vector<SearchState> states(num_threads);
+
+  // Thread t evaluates the samples of lexicographic rank in [begin, end).
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+  for (int t = 0; t < num_threads; t++) {
+    SearchState& state = states[t];
+    QualityMeasurement* quality_measurement = (*quality_measurements)[t].get();
+    const int begin =
+        static_cast<long long>(num_combinations) * t / num_threads;
+    const int end =
+        static_cast<long long>(num_combinations) * (t + 1) / num_threads;
+
+    CombinationEnumerator combinations(data.size(), sample_size);
+    combinations.SeekToRank(begin);
+    std::vector<Datum> data_subset(sample_size);
+    std::vector<Model> temp_models;
+    std::vector<double> residuals;
+    for (int rank = begin; rank < end && !Cancelled();
+         rank++, combinations.Next()) {
+      state.num_iterations++;
+      for (int i = 0; i < sample_size; i++) {
+        data_subset[i] = data[combinations.Indices()[i]];
+      }
+      if (!estimator_.ValidSample(data_subset)) {
+        state.num_rejected_samples++;
+        continue;
+      }
+
+      temp_models.clear();
+      if (!estimator_.EstimateModel(data_subset, &temp_models)) {
+        continue;
+      }
+
+      for (const Model& temp_model : temp_models) {
+        if (model_prior_ != nullptr &&
+            !model_prior_->IsConsistent(temp_model)) {
+          state.num_prior_rejected_models++;
+          continue;
+        }
+        if (!estimator_.ValidModel(temp_model) ||
+            !estimator_.ValidModelForSample(data_subset, temp_model,
+                                            ransac_params_.error_thresh)) {
+          state.num_rejected_models++;
+          continue;
+        }
+
+        estimator_.ComputeResiduals(data, temp_model, &residuals);
+        const double sample_cost = quality_measurement->ComputeCost(residuals);
+        if (sample_cost < state.best_cost) {
+          state.best_cost = sample_cost;
+          state.best_model = temp_model;
+          residuals.swap(state.best_residuals);
+        }
+      }
+    }
+  }
+
+  // Merge the ranges in order so that ties are resolved as in a sequential
+  // enumeration.
+  int best_state = -1;
+  for (int t = 0; t < num_threads; t++) {
+    summary->num_iterations += states[t].num_iterations;
+    summary->num_rejected_samples += states[t].num_rejected_samples;
+    summary->num_rejected_models += states[t].num_rejected_models;
+    summary->num_prior_rejected_models += states[t].num_prior_rejected_models;
+    if (!states[t].best_residuals.empty() &&
+        states[t].best_cost < *best_cost) {
+      *best_cost = states[t].best_cost;
+      best_state = t;
+    }
+  }
+  if (best_state >= 0) {
+    *best_model = states[best_state].best_model;
+    summary->residuals.swap(states[best_state].best_residuals);
+    ReportProgress();
+  }
+}
+
 template <class ModelEstimator>
 int SampleConsensusEstimator<ModelEstimator>::ComputeMaxIterations(
     const double min_sample_size,
@@ -208,7 +689,99 @@ int SampleConsensusEstimator<ModelEstimator>::ComputeMaxIterations(
 }
 
 template <class ModelEstimator>
-bool SampleConsensusEstimator<ModelEstimator>::Estimate(
+int SampleConsensusEstimator<ModelEstimator>::UpdateMaxIterations(
+    const std::vector<double>& residuals,
+    const double log_failure_prob,
+    const int max_iterations) {
+  const double inlier_ratio = quality_measurement_->GetInlierRatio();
+  if (inlier_ratio <
+      estimator_.SampleSize() / static_cast<double>(residuals.size())) {
+    return max_iterations;
+  }
+
+  // A better cost does not guarantee a higher inlier ratio (i.e, the MLE
+  // case) so we only update the max iterations if the number decreases.
+  const int updated_max_iterations =
+      std::min(ComputeMaxIterations(estimator_.SampleSize(),
+                                    inlier_ratio,
+                                    log_failure_prob),
+               max_iterations);
+
+  VLOG(3) << "Inlier ratio = " << inlier_ratio
+          << " and max number of iterations = " << updated_max_iterations;
+  return updated_max_iterations;
+}
+
+template <class ModelEstimator>
+bool SampleConsensusEstimator<ModelEstimator>::EvaluateSample(
+    const std::vector<Datum>& data,
+    const bool use_tdd_test,
+    Model* best_model,
+    double* best_cost,
+    std::vector<double>* best_residuals,
+    RansacSummary* summary) {
+  const std::vector<Datum>& data_subset = workspace_.data_subset;
+  std::vector<Model>& temp_models = workspace_.models;
+  std::vector<double>& residuals = workspace_.residuals;
+
+  // Reject degenerate samples before running the (expensive) solver.
+  if (!estimator_.ValidSample(data_subset)) {
+    summary->num_rejected_samples++;
+    return false;
+  }
+
+  // Estimate model from subset. Skip to next iteration if the model fails to
+  // estimate.
+  temp_models.clear();
+  if (!estimator_.EstimateModel(data_subset, &temp_models)) {
+    return false;
+  }
+
+  // With the T(1,1) test, all models of the sample are verified on the same
+  // randomly selected datum.
+  const int tdd_test_index = use_tdd_test && ransac_params_.use_Tdd_test
+                                 ? RandInt(0, data.size() - 1)
+                                 : -1;
+
+  // Calculate residuals from estimated model.
+  bool found_better_model = false;
+  for (const Model& temp_model : temp_models) {
+    // Drop models that contradict the prior or are impossible before the
+    // O(N) scoring pass.
+    if (model_prior_ != nullptr && !model_prior_->IsConsistent(temp_model)) {
+      summary->num_prior_rejected_models++;
+      continue;
+    }
+    if (!estimator_.ValidModel(temp_model) ||
+        !estimator_.ValidModelForSample(data_subset, temp_model,
+                                        ransac_params_.error_thresh) ||
+        (tdd_test_index >= 0 &&
+         estimator_.Error(data[tdd_test_index], temp_model) >=
+             ransac_params_.error_thresh)) {
+      summary->num_rejected_models++;
+      continue;
+    }
+
+    estimator_.ComputeResiduals(data, temp_model, &residuals);
+
+    // Determine cost of the generated model.
+    const double sample_cost = quality_measurement_->ComputeCost(residuals);
+
+    // Update best model if error is the best we have seen.
+    if (sample_cost < *best_cost) {
+      *best_model = temp_model;
+      *best_cost = sample_cost;
+      // Keep the residuals of the best model by swapping the buffers rather
+      // than copying them.
+      residuals.swap(*best_residuals);
+      found_better_model = true;
+    }
+  }
+  return found_better_model;
+}
+
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::Start(
     const std::vector<Datum>& data,
     Model* best_model,
     RansacSummary* summary) {
@@ -219,75 +792,213 @@ bool SampleConsensusEstimator<ModelEstimator>::Estimate(
   CHECK_NOTNULL(summary);
   CHECK_NOTNULL(best_model);
 
-  const double log_failure_prob = log(ransac_params_.failure_probability);
-  double best_cost = std::numeric_limits<double>::max();
-  int max_iterations = ransac_params_.max_iterations;
+  state_.data = &data;
+  state_.best_model = best_model;
+  state_.summary = summary;
+  state_.best_cost = std::numeric_limits<double>::max();
+  state_.log_failure_prob = log(ransac_params_.failure_probability);
+  state_.max_iterations = ransac_params_.max_iterations;
+  state_.num_consecutive_duplicate_samples = 0;
+  state_.finished = false;
+  // The inlier ratio of the previous estimation must not bound the number of
+  // iterations of this one.
+  quality_measurement_->ResetInlierRatio();
 
   // Set the max iterations if the inlier ratio is set.
   if (ransac_params_.min_inlier_ratio > 0) {
-    max_iterations = std::min(
+    state_.max_iterations = std::min(
         ComputeMaxIterations(estimator_.SampleSize(),
                              ransac_params_.min_inlier_ratio,
-                             log_failure_prob),
+                             state_.log_failure_prob),
         ransac_params_.max_iterations);
   }
 
-  for (summary->num_iterations = 0;
-       summary->num_iterations < max_iterations;
-       summary->num_iterations++) {
+  workspace_.Reserve(data.size(), estimator_.SampleSize());
+  std::vector<double>& residuals = workspace_.residuals;
+  // The residuals of the best model are kept in the summary, which is double
+  // buffered with the residuals of the workspace.
+  std::vector<double>& best_residuals = summary->residuals;
+  best_residuals.clear();
+  best_residuals.reserve(data.size());
+  summary->num_iterations = 0;
+  summary->num_rejected_samples = 0;
+  summary->num_rejected_models = 0;
+  summary->num_prior_rejected_models = 0;
+  summary->num_duplicate_samples = 0;
+  summary->cancelled = false;
+
+  // Score the initial models first so that a good one bounds the number of
+  // iterations right away.
+  if (initial_models_ != nullptr) {
+    for (const Model& initial_model : *initial_models_) {
+      if (model_prior_ != nullptr &&
+          !model_prior_->IsConsistent(initial_model)) {
+        summary->num_prior_rejected_models++;
+        continue;
+      }
+      if (!estimator_.ValidModel(initial_model)) {
+        continue;
+      }
+      estimator_.ComputeResiduals(data, initial_model, &residuals);
+      const double initial_cost = quality_measurement_->ComputeCost(residuals);
+      if (initial_cost < state_.best_cost) {
+        *best_model = initial_model;
+        state_.best_cost = initial_cost;
+        residuals.swap(best_residuals);
+        state_.max_iterations =
+            UpdateMaxIterations(best_residuals, state_.log_failure_prob,
+                                state_.max_iterations);
+        ReportProgress();
+      }
+    }
+  }
+
+  if (ransac_params_.use_sample_cache) {
+    sample_cache_.Reset(data.size(), estimator_.SampleSize(),
+                        estimator_.SampleOrderMatters());
+  }
+}
+
+template <class ModelEstimator>
+bool SampleConsensusEstimator<ModelEstimator>::Step(const int num_iterations) {
+  CHECK(state_.data != nullptr) << "Start must be called before Step.";
+  if (state_.finished) {
+    return true;
+  }
+
+  const std::vector<Datum>& data = *state_.data;
+  RansacSummary* summary = state_.summary;
+  std::vector<Datum>& data_subset = workspace_.data_subset;
+  std::vector<double>& best_residuals = summary->residuals;
+
+  for (int num_steps = 0;
+       num_steps < num_iterations &&
+       summary->num_iterations < state_.max_iterations;
+       num_steps++, summary->num_iterations++) {
+    if (Cancelled()) {
+      summary->cancelled = true;
+      state_.finished = true;
+      break;
+    }
+
     // Sample subset. Proceed if successfully sampled.
-    std::vector<Datum> data_subset;
     if (!sampler_->Sample(data, &data_subset)) {
       continue;
     }
 
-    // Estimate model from subset. Skip to next iteration if the model fails to
-    // estimate.
-    std::vector<Model> temp_models;
-    if (!estimator_.EstimateModel(data_subset, &temp_models)) {
+    // Skip samples that have already been evaluated. They do not count as an
+    // iteration, unless every sample has been evaluated already or too many
+    // duplicates have been drawn in a row. The cache is only exhausted if the
+    // sampler can draw every sample, which biased samplers may never do.
+    if (ransac_params_.use_sample_cache &&
+        !sample_cache_.Insert(sampler_->SampleIndices())) {
+      summary->num_duplicate_samples++;
+      if (sample_cache_.Exhausted()) {
+        state_.finished = true;
+        break;
+      }
+      if (++state_.num_consecutive_duplicate_samples <=
+          kMaxConsecutiveDuplicateSamples) {
+        summary->num_iterations--;
+      }
       continue;
     }
+    state_.num_consecutive_duplicate_samples = 0;
+
+    // Estimate and score the models of the sample.
+    if (EvaluateSample(data, true, state_.best_model, &state_.best_cost,
+                       &best_residuals, summary)) {
+      state_.max_iterations =
+          UpdateMaxIterations(best_residuals, state_.log_failure_prob,
+                              state_.max_iterations);
+      ReportProgress();
+    }
+  }
 
-    // Calculate residuals from estimated model.
-    for (const Model& temp_model : temp_models) {
-      std::vector<double> residuals = estimator_.Residuals(data, temp_model);
+  if (state_.finished || summary->num_iterations >= state_.max_iterations) {
+    Finish();
+  }
+  return state_.finished;
+}
 
-      // Determine cost of the generated model.
-      double sample_cost = quality_measurement_->ComputeCost(residuals);
+template <class ModelEstimator>
+double SampleConsensusEstimator<ModelEstimator>::Confidence() const {
+  CHECK_NOTNULL(state_.summary);
+  return ComputeConfidence(NumInliers());
+}
 
-      // Update best model if error is the best we have seen.
-      if (sample_cost < best_cost) {
-        *best_model = temp_model;
-        best_cost = sample_cost;
+template <class ModelEstimator>
+int SampleConsensusEstimator<ModelEstimator>::NumInliers() const {
+  const std::vector<double>& residuals = state_.summary->residuals;
+  return std::count_if(residuals.begin(), residuals.end(),
+                       [this](const double residual) {
+                         return residual < ransac_params_.error_thresh;
+                       });
+}
 
-        const double inlier_ratio = quality_measurement_->GetInlierRatio();
-        if (inlier_ratio <
-            estimator_.SampleSize() / static_cast<double>(data.size())) {
-          continue;
-        }
+template <class ModelEstimator>
+double SampleConsensusEstimator<ModelEstimator>::ComputeConfidence(
+    const int num_inliers) const {
+  const double inlier_ratio =
+      static_cast<double>(num_inliers) / state_.data->size();
+  return 1.0 - pow(1.0 - pow(inlier_ratio, estimator_.SampleSize()),
+                   state_.summary->num_iterations);
+}
 
-        // A better cost does not guarantee a higher inlier ratio (i.e, the MLE
-        // case) so we only update the max iterations if the number decreases.
-        max_iterations = std::min(ComputeMaxIterations(estimator_.SampleSize(),
-                                                       inlier_ratio,
-                                                       log_failure_prob),
-                                  max_iterations);
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::ReportProgress() {
+  if (!progress_callback_) {
+    return;
+  }
+  const int num_inliers = NumInliers();
+  ReportProgress(*state_.best_model,
+                 static_cast<double>(num_inliers) / state_.data->size(),
+                 ComputeConfidence(num_inliers));
+}
 
-        VLOG(3) << "Inlier ratio = " << inlier_ratio
-                << " and max number of iterations = " << max_iterations;
-      }
-    }
+template <class ModelEstimator>
+void SampleConsensusEstimator<ModelEstimator>::Finish() {
+  // The inliers are read from the residuals kept for the best model rather
+  // than evaluating the model on the data again.
+  SetInliersFromResiduals(ransac_params_.error_thresh, state_.summary);
+  state_.summary->confidence =
+      ComputeConfidence(state_.summary->inliers.size());
+  state_.finished = true;
+}
+
+template <class ModelEstimator>
+bool SampleConsensusEstimator<ModelEstimator>::Estimate(
+    const std::vector<Datum>& data,
+    Model* best_model,
+    RansacSummary* summary) {
+  Start(data, best_model, summary);
+
+  // Evaluate every sample when that takes no more iterations than sampling.
+  const double num_combinations = CombinationEnumerator::NumCombinations(
+      data.size(), estimator_.SampleSize());
+  if (ransac_params_.use_exhaustive_enumeration &&
+      state_.max_iterations < std::numeric_limits<int>::max() &&
+      num_combinations <= state_.max_iterations) {
+    EstimateExhaustively(data, num_combinations, &state_.best_cost,
+                         best_model, summary);
+    state_.finished = true;
+    return !summary->cancelled;
   }
 
-  summary->inliers =
-      estimator_.GetInliers(data, *best_model, ransac_params_.error_thresh);
-  const double inlier_ratio =
-      static_cast<double>(summary->inliers.size()) / data.size();
-  summary->confidence =
-      1.0 - pow(1.0 - pow(inlier_ratio, estimator_.SampleSize()),
-                summary->num_iterations);
+  Step(std::numeric_limits<int>::max());
+  return !summary->cancelled;
+}
 
-  return true;
+template <class ModelEstimator>
+bool SampleConsensusEstimator<ModelEstimator>::EstimateWithInitialModels(
+    const std::vector<Datum>& data,
+    const std::vector<Model>& initial_models,
+    Model* best_model,
+    RansacSummary* summary) {
+  initial_models_ = &initial_models;
+  const bool success = Estimate(data, best_model, summary);
+  initial_models_ = nullptr;
+  return success;
 }
 
 }  // namespace theia
@@ -24,8 +24,15 @@ template <class Datum> class Sampler {
   virtual bool Sample(const std::vector<Datum>& data,
                       std::vector<Datum>* subset) = 0;
 
+  // The indices into the data of the last sample, in the order of the subset.
+  // Samplers that do not record their indices leave it empty.
+  const std::vector<int>& SampleIndices() const { return sample_indices_; }
+
  protected:
   int min_num_samples_;
+
+  // The indices of the last sample (see SampleIndices).
+  std::vector<int> sample_indices_;
 };
 
 }  // namespace theia
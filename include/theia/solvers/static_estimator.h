@@ -0,0 +1,223 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_SOLVERS_STATIC_ESTIMATOR_H_
+#define THEIA_SOLVERS_STATIC_ESTIMATOR_H_
+
+#include <glog/logging.h>
+#ifdef THEIA_USE_OPENMP
+#include <omp.h>
+#endif
+#include <type_traits>
+#include <vector>
+
+#include "theia/solvers/estimator.h"
+
+namespace theia {
+// Statically dispatched counterpart of Estimator (see estimator.h). Derived
+// classes pass themselves as the first template parameter (CRTP) and implement
+// the same methods as for Estimator, but without the virtual keyword:
+//
+//   class LineEstimator
+//       : public StaticEstimator<LineEstimator, Point, Line> {
+//    public:
+//     double SampleSize() const { return 2; }
+//     bool EstimateModel(const std::vector<Point>& data,
+//                        std::vector<Line>* models) const;
+//     double Error(const Point& point, const Line& line) const;
+//   };
+//
+// The sample consensus estimators (Ransac, Prosac, Arrsac, ...) are templated
+// on the estimator type, so every call they make into a StaticEstimator is
+// resolved at compile time and the per-point Error() calls may be inlined into
+// the scoring loops. The virtual Estimator interface remains available for
+// estimators that need runtime polymorphism; both can be used interchangeably
+// with the sample consensus estimators, and VirtualEstimatorAdapter (below)
+// exposes a StaticEstimator through the Estimator interface.
+template <class Derived, typename DatumType, typename ModelType>
+class StaticEstimator {
+ public:
+  typedef DatumType Datum;
+  typedef ModelType Model;
+
+  // Enable a quick check to see if the sample is valid before a model is
+  // estimated from it. By default, every sample is valid.
+  bool ValidSample(const std::vector<Datum>& sample) const { return true; }
+
+  // Returns true if the models estimated from a sample depend on the order of
+  // its data points. By default, they do not.
+  bool SampleOrderMatters() const { return false; }
+
+  // Estimate a model from a non-minimal sampling of the data. By default, this
+  // simply implements the minimal case.
+  bool EstimateModelNonminimal(const std::vector<Datum>& data,
+                               std::vector<Model>* model) const {
+    return derived().EstimateModel(data, model);
+  }
+
+  // Refine the model based on an updated subset of data, and a pre-computed
+  // model. Can be optionally implemented.
+  bool RefineModel(const std::vector<Datum>& data, Model* model) const {
+    return true;
+  }
+
+  // Compute the residuals of many data points. By default this is just a loop
+  // that calls Error() on each data point.
+  std::vector<double> Residuals(const std::vector<Datum>& data,
+                                const Model& model) const {
+    std::vector<double> residuals;
+    ComputeErrors(data, model, &residuals);
+    return residuals;
+  }
+
+  // Compute the residuals of many data points into the output vector, so that
+  // its storage may be reused. This is the method called by the sample
+  // consensus estimators. As for Estimator, it forwards to Residuals if the
+  // derived class hides Residuals, and otherwise loops over Error() without
+  // allocating. Derived classes may hide ComputeResiduals to compute the
+  // residuals of multiple points simultaneously.
+  void ComputeResiduals(const std::vector<Datum>& data,
+                        const Model& model,
+                        std::vector<double>* residuals) const {
+    if (std::is_same<decltype(&Derived::Residuals),
+                     decltype(&StaticEstimator::Residuals)>::value) {
+      ComputeErrors(data, model, residuals);
+    } else {
+      *residuals = derived().Residuals(data, model);
+    }
+  }
+
+  // Returns the set inliers of the data set based on the error threshold
+  // provided.
+  std::vector<int> GetInliers(const std::vector<Datum>& data,
+                              const Model& model,
+                              double error_threshold) const {
+    std::vector<int> inliers;
+    GetInliers(data, model, error_threshold, &inliers);
+    return inliers;
+  }
+
+  // Same as above, but the inliers are written to the output vector so that its
+  // storage may be reused.
+  void GetInliers(const std::vector<Datum>& data,
+                  const Model& model,
+                  double error_threshold,
+                  std::vector<int>* inliers) const {
+    inliers->clear();
+    inliers->reserve(data.size());
+    for (int i = 0; i < data.size(); i++) {
+      if (derived().Error(data[i], model) < error_threshold) {
+        inliers->push_back(i);
+      }
+    }
+  }
+
+  // Enable a quick check to see if the model is valid. This can be a geometric
+  // check or some other verification of the model structure.
+  bool ValidModel(const Model& model) const { return true; }
+
+  // Enable a quick check of a model against the sample it was estimated from.
+  // By default, every model is valid.
+  bool ValidModelForSample(const std::vector<Datum>& sample,
+                           const Model& model,
+                           const double error_thresh) const {
+    return true;
+  }
+
+ protected:
+  StaticEstimator() {}
+  ~StaticEstimator() {}
+
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+
+ private:
+  // Computes the residuals with Error() into the output vector.
+  void ComputeErrors(const std::vector<Datum>& data,
+                     const Model& model,
+                     std::vector<double>* residuals) const {
+    residuals->resize(data.size());
+#pragma omp parallel for
+    for (int i = 0; i < data.size(); i++) {
+      (*residuals)[i] = derived().Error(data[i], model);
+    }
+  }
+};
+
+// Exposes a StaticEstimator through the virtual Estimator interface, for code
+// that holds estimators as Estimator<Datum, Model>* (e.g. to choose one at
+// runtime):
+//
+//   P3PEstimator p3p_estimator;
+//   VirtualEstimatorAdapter<P3PEstimator> estimator(p3p_estimator);
+//   Ransac<Estimator<Datum, Model> > ransac(ransac_params, estimator);
+//
+// Every method forwards to the static estimator, which is not owned and must
+// outlive the adapter. Calls through the adapter are virtual again, but the
+// residuals of all of the data are still computed with a single virtual call
+// to ComputeResiduals.
+template <class StaticEstimatorT>
+class VirtualEstimatorAdapter
+    : public Estimator<typename StaticEstimatorT::Datum,
+                       typename StaticEstimatorT::Model> {
+ public:
+  typedef typename StaticEstimatorT::Datum Datum;
+  typedef typename StaticEstimatorT::Model Model;
+
+  explicit VirtualEstimatorAdapter(const StaticEstimatorT& estimator)
+      : estimator_(estimator) {}
+  ~VirtualEstimatorAdapter() {}
+
+  double SampleSize() const { return estimator_.SampleSize(); }
+
+  bool ValidSample(const std::vector<Datum>& sample) const {
+    return estimator_.ValidSample(sample);
+  }
+
+  bool SampleOrderMatters() const { return estimator_.SampleOrderMatters(); }
+
+  bool EstimateModel(const std::vector<Datum>& data,
+                     std::vector<Model>* model) const {
+    return estimator_.EstimateModel(data, model);
+  }
+
+  bool EstimateModelNonminimal(const std::vector<Datum>& data,
+                               std::vector<Model>* model) const {
+    return estimator_.EstimateModelNonminimal(data, model);
+  }
+
+  bool RefineModel(const std::vector<Datum>& data, Model* model) const {
+    return estimator_.RefineModel(data, model);
+  }
+
+  double Error(const Datum& data, const Model& model) const {
+    return estimator_.Error(data, model);
+  }
+
+  std::vector<double> Residuals(const std::vector<Datum>& data,
+                                const Model& model) const {
+    return estimator_.Residuals(data, model);
+  }
+
+  void ComputeResiduals(const std::vector<Datum>& data,
+                        const Model& model,
+                        std::vector<double>* residuals) const {
+    estimator_.ComputeResiduals(data, model, residuals);
+  }
+
+  bool ValidModel(const Model& model) const {
+    return estimator_.ValidModel(model);
+  }
+
+  bool ValidModelForSample(const std::vector<Datum>& sample,
+                           const Model& model,
+                           const double error_thresh) const {
+    return estimator_.ValidModelForSample(sample, model, error_thresh);
+  }
+
+ private:
+  const StaticEstimatorT& estimator_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_STATIC_ESTIMATOR_H_
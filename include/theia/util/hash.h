@@ -4,6 +4,7 @@
 #ifndef THEIA_UTIL_HASH_H_
 #define THEIA_UTIL_HASH_H_
 
+#include <array>
 #include <utility>
 
 // This file defines hash functions for stl containers.
@@ -34,6 +35,18 @@ template <typename T1, typename T2> struct hash<std::pair<T1, T2> > {
   }
 };
 
+// Hash of a fixed size array, e.g. a tuple of sample indices.
+template <typename T, size_t N> struct hash<std::array<T, N> > {
+ public:
+  size_t operator()(const std::array<T, N>& e) const {
+    size_t seed = 0;
+    for (const T& value : e) {
+      HashCombine(value, &seed);
+    }
+    return seed;
+  }
+};
+
 }  // namespace std
 
 #endif  // THEIA_UTIL_HASH_H_
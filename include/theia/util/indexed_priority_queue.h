@@ -0,0 +1,200 @@
+// Please contact the author of this library if you have any questions.
+// Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
+
+#ifndef THEIA_UTIL_INDEXED_PRIORITY_QUEUE_H_
+#define THEIA_UTIL_INDEXED_PRIORITY_QUEUE_H_
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace theia {
+
+// A mutable priority queue over the integer keys 0, 1, 2, ... (e.g. hypothesis
+// or correspondence indices), implemented as an indexed 4-ary heap. The
+// entries are stored by value in one contiguous array and the position of
+// each key in the heap is stored in a second array indexed by key, so that
+// updating, erasing or looking up a key is O(log n) or O(1) with no hashing and
+// no memory allocation once the queue has been reserved. A 4-ary heap is half
+// as deep as a binary heap and the children of a node share a cache line,
+// which makes it faster for heaps that are updated often.
+//
+// This has the same interface as mutable_priority_queue, which should still be
+// used for non-integer or sparse keys. By default this is a min-heap that puts
+// the smaller values at the top, which may be customized by providing a method
+// ValueComp to perform the element-wise comparison.
+template <typename Value, typename ValueComp = std::greater<Value> >
+class IndexedPriorityQueue {
+ public:
+  IndexedPriorityQueue() {}
+
+  // Reserves memory for the keys 0 to num_keys - 1.
+  void reserve(const int num_keys) {
+    heap_.reserve(num_keys);
+    if (num_keys > positions_.size()) {
+      positions_.resize(num_keys, kNotInQueue);
+    }
+  }
+
+  // Empties the queue. The memory is kept.
+  void clear() {
+    for (const Entry& entry : heap_) {
+      positions_[entry.key] = kNotInQueue;
+    }
+    heap_.clear();
+  }
+
+  // Returns true if the queue is empty.
+  bool empty() const { return heap_.empty(); }
+
+  // Returns the number of elements in the queue.
+  size_t size() const { return heap_.size(); }
+
+  bool contains(const int key) const {
+    return key >= 0 && key < positions_.size() &&
+           positions_[key] != kNotInQueue;
+  }
+
+  // Returns the key and the value at the top of the queue.
+  std::pair<int, Value> top() const {
+    DCHECK(!empty());
+    return std::make_pair(heap_[0].key, heap_[0].value);
+  }
+
+  // Returns the value for the key.
+  const Value& find(const int key) const {
+    CHECK(contains(key)) << "Key " << key << " is not in the queue.";
+    return heap_[positions_[key]].value;
+  }
+
+  // Pushes an entry onto the priority queue. The key must not be in the queue.
+  void insert(const int key, const Value& value) {
+    CHECK_GE(key, 0);
+    if (key >= positions_.size()) {
+      positions_.resize(key + 1, kNotInQueue);
+    }
+    CHECK_EQ(positions_[key], kNotInQueue)
+        << "Key " << key << " is already in the queue.";
+    heap_.push_back(Entry(key, value));
+    positions_[key] = heap_.size() - 1;
+    SiftUp(heap_.size() - 1);
+  }
+
+  // Updates the value of an entry and moves it to its proper position.
+  void update(const int key, const Value& value) {
+    CHECK(contains(key)) << "Key " << key << " is not in the queue.";
+    const int position = positions_[key];
+    heap_[position].value = value;
+    SiftDown(SiftUp(position));
+  }
+
+  // Removes the front entry in the queue.
+  void pop() {
+    DCHECK(!empty());
+    RemoveAt(0);
+  }
+
+  // Removes the entry of the key, if any.
+  void erase(const int key) {
+    if (contains(key)) {
+      RemoveAt(positions_[key]);
+    }
+  }
+
+ private:
+  // The number of children of each node.
+  static const int kArity = 4;
+  static const int kNotInQueue = -1;
+
+  struct Entry {
+    Entry(const int key, const Value& value) : key(key), value(value) {}
+    int key;
+    Value value;
+  };
+
+  // Returns true if entry1 belongs above entry2 in the heap.
+  bool Precedes(const Entry& entry1, const Entry& entry2) const {
+    return comp_(entry2.value, entry1.value);
+  }
+
+  // Moves the entry to the position and updates the index of its key.
+  void Place(Entry&& entry, const int position) {
+    positions_[entry.key] = position;
+    heap_[position] = std::move(entry);
+  }
+
+  // Moves the entry at the position up to its proper position, which is
+  // returned.
+  int SiftUp(int position) {
+    Entry entry = std::move(heap_[position]);
+    while (position > 0) {
+      const int parent = (position - 1) / kArity;
+      if (!Precedes(entry, heap_[parent])) {
+        break;
+      }
+      Place(std::move(heap_[parent]), position);
+      position = parent;
+    }
+    Place(std::move(entry), position);
+    return position;
+  }
+
+  // Moves the entry at the position down to its proper position.
+  void SiftDown(int position) {
+    const int size = heap_.size();
+    Entry entry = std::move(heap_[position]);
+    while (true) {
+      const int first_child = kArity * position + 1;
+      if (first_child >= size) {
+        break;
+      }
+      const int last_child = std::min(first_child + kArity, size);
+      int best_child = first_child;
+      for (int child = first_child + 1; child < last_child; child++) {
+        if (Precedes(heap_[child], heap_[best_child])) {
+          best_child = child;
+        }
+      }
+      if (!Precedes(heap_[best_child], entry)) {
+        break;
+      }
+      Place(std::move(heap_[best_child]), position);
+      position = best_child;
+    }
+    Place(std::move(entry), position);
+  }
+
+  // Removes the entry at the position by replacing it with the last entry.
+  void RemoveAt(const int position) {
+    positions_[heap_[position].key] = kNotInQueue;
+    const int last = heap_.size() - 1;
+    if (position != last) {
+      Place(std::move(heap_[last]), position);
+      heap_.pop_back();
+      SiftDown(SiftUp(position));
+    } else {
+      heap_.pop_back();
+    }
+  }
+
+  ValueComp comp_;
+
+  // The entries, in 4-ary heap order: the children of heap_[i] are
+  // heap_[4 * i + 1] to heap_[4 * i + 4].
+  std::vector<Entry> heap_;
+
+  // The position in heap_ of each key, or kNotInQueue.
+  std::vector<int> positions_;
+};
+
+template <typename Value, typename ValueComp>
+const int IndexedPriorityQueue<Value, ValueComp>::kArity;
+
+template <typename Value, typename ValueComp>
+const int IndexedPriorityQueue<Value, ValueComp>::kNotInQueue;
+
+}  // namespace theia
+
+#endif  // THEIA_UTIL_INDEXED_PRIORITY_QUEUE_H_
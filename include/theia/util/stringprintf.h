@@ -30,6 +30,15 @@ extern std::string StringPrintf(const char* format, ...)
     // Tell the compiler to do printf format string checking.
     THEIA_PRINTF_ATTRIBUTE(1, 2);
 
+// Append result to a supplied string.
+extern void StringAppendF(std::string* dst, const char* format, ...)
+    // Tell the compiler to do printf format string checking.
+    THEIA_PRINTF_ATTRIBUTE(2, 3);
+
+// Lower-level routine that takes a va_list and appends to a specified string.
+// All other routines are just convenience wrappers around it.
+extern void StringAppendV(std::string* dst, const char* format, va_list ap);
+
 }  // namespace theia
 
 #endif  // THEIA_UTIL_STRINGPRINTF_H_
@@ -0,0 +1,190 @@
+// Please contact the author of this library if you have any questions.
+
+#include "theia/math/probability/gamma_distribution.h"
+
+#include <glog/logging.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace theia {
+
+namespace {
+
+static const int kMaxIncompleteGammaIterations = 500;
+static const double kIncompleteGammaEpsilon = 1e-14;
+
+// Series expansion of P(a, x), which converges quickly for x < a + 1.
+double LowerIncompleteGammaSeries(const double a, const double x) {
+  double term = 1.0 / a;
+  double sum = term;
+  for (int n = 1; n < kMaxIncompleteGammaIterations; n++) {
+    term *= x / (a + n);
+    sum += term;
+    if (std::abs(term) < std::abs(sum) * kIncompleteGammaEpsilon) {
+      break;
+    }
+  }
+  return sum * std::exp(-x + a * std::log(x) - std::lgamma(a));
+}
+
+// Continued fraction of Q(a, x) evaluated with the modified Lentz method, which
+// converges quickly for x >= a + 1.
+double UpperIncompleteGammaContinuedFraction(const double a, const double x) {
+  static const double kTiny =
+      std::numeric_limits<double>::min() / kIncompleteGammaEpsilon;
+  double b = x + 1.0 - a;
+  double c = 1.0 / kTiny;
+  double d = 1.0 / b;
+  double h = d;
+  for (int n = 1; n < kMaxIncompleteGammaIterations; n++) {
+    const double an = -n * (n - a);
+    b += 2.0;
+    d = an * d + b;
+    if (std::abs(d) < kTiny) {
+      d = kTiny;
+    }
+    c = b + an / c;
+    if (std::abs(c) < kTiny) {
+      c = kTiny;
+    }
+    d = 1.0 / d;
+    const double delta = d * c;
+    h *= delta;
+    if (std::abs(delta - 1.0) < kIncompleteGammaEpsilon) {
+      break;
+    }
+  }
+  return std::exp(-x + a * std::log(x) - std::lgamma(a)) * h;
+}
+
+// The digamma function, i.e. the derivative of log(Gamma(x)), for x > 0.
+double Digamma(double x) {
+  double result = 0.0;
+  // Use the recurrence psi(x) = psi(x + 1) - 1 / x to reach the range where the
+  // asymptotic expansion is accurate.
+  while (x < 6.0) {
+    result -= 1.0 / x;
+    x += 1.0;
+  }
+  const double inv_x2 = 1.0 / (x * x);
+  result += std::log(x) - 0.5 / x -
+            inv_x2 * (1.0 / 12.0 -
+                      inv_x2 * (1.0 / 120.0 - inv_x2 * (1.0 / 252.0)));
+  return result;
+}
+
+// The trigamma function, i.e. the derivative of the digamma function, for
+// x > 0.
+double Trigamma(double x) {
+  double result = 0.0;
+  while (x < 6.0) {
+    result += 1.0 / (x * x);
+    x += 1.0;
+  }
+  const double inv_x = 1.0 / x;
+  const double inv_x2 = inv_x * inv_x;
+  result += inv_x + 0.5 * inv_x2 +
+            inv_x * inv_x2 *
+                (1.0 / 6.0 - inv_x2 * (1.0 / 30.0 - inv_x2 * (1.0 / 42.0)));
+  return result;
+}
+
+}  // namespace
+
+double RegularizedLowerIncompleteGamma(const double a, const double x) {
+  DCHECK_GT(a, 0.0);
+  if (x <= 0.0) {
+    return 0.0;
+  }
+  if (x < a + 1.0) {
+    return LowerIncompleteGammaSeries(a, x);
+  }
+  return 1.0 - UpperIncompleteGammaContinuedFraction(a, x);
+}
+
+double RegularizedUpperIncompleteGamma(const double a, const double x) {
+  DCHECK_GT(a, 0.0);
+  if (x <= 0.0) {
+    return 1.0;
+  }
+  if (x < a + 1.0) {
+    return 1.0 - LowerIncompleteGammaSeries(a, x);
+  }
+  return UpperIncompleteGammaContinuedFraction(a, x);
+}
+
+double GammaPdf(const double x, const double k, const double theta) {
+  if (x < 0.0) {
+    return 0.0;
+  }
+  if (x == 0.0) {
+    if (k == 1.0) {
+      return 1.0 / theta;
+    }
+    return k < 1.0 ? std::numeric_limits<double>::infinity() : 0.0;
+  }
+  return std::exp((k - 1.0) * std::log(x) - x / theta - std::lgamma(k) -
+                  k * std::log(theta));
+}
+
+double GammaCdf(const double x, const double k, const double theta) {
+  return RegularizedLowerIncompleteGamma(k, x / theta);
+}
+
+bool FitGamma(const std::vector<double>& samples, double* k, double* theta) {
+  static const int kMaxNewtonIterations = 100;
+  static const double kNewtonTolerance = 1e-10;
+
+  CHECK_NOTNULL(k);
+  CHECK_NOTNULL(theta);
+  if (samples.size() < 2) {
+    return false;
+  }
+
+  double mean = 0.0;
+  double mean_log = 0.0;
+  for (const double sample : samples) {
+    if (sample <= 0.0) {
+      return false;
+    }
+    mean += sample;
+    mean_log += std::log(sample);
+  }
+  mean /= samples.size();
+  mean_log /= samples.size();
+
+  // s is zero only if all samples are equal, in which case the distribution is
+  // degenerate.
+  const double s = std::log(mean) - mean_log;
+  if (!(s > 0.0)) {
+    return false;
+  }
+
+  // Initial estimate followed by the generalized Newton iterations of Minka,
+  // which approximate the likelihood by c + a * log(shape) + b * shape instead
+  // of a quadratic, so that 1 / shape is updated rather than shape.
+  double shape = (3.0 - s + std::sqrt((s - 3.0) * (s - 3.0) + 24.0 * s)) /
+                 (12.0 * s);
+  for (int i = 0; i < kMaxNewtonIterations; i++) {
+    const double gradient = std::log(shape) - Digamma(shape) - s;
+    const double hessian = 1.0 / shape - Trigamma(shape);
+    const double updated_shape =
+        1.0 / (1.0 / shape + gradient / (shape * shape * hessian));
+    if (!(updated_shape > 0.0)) {
+      break;
+    }
+    const bool converged =
+        std::abs(updated_shape - shape) < kNewtonTolerance * shape;
+    shape = updated_shape;
+    if (converged) {
+      break;
+    }
+  }
+
+  *k = shape;
+  *theta = mean / shape;
+  return std::isfinite(*k) && std::isfinite(*theta);
+}
+
+}  // namespace theia
@@ -0,0 +1,265 @@
+// Please contact the author of this library if you have any questions.
+
+#include "theia/math/probability/gev_distribution.h"
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace theia {
+
+namespace {
+
+// Shapes closer to zero than this are treated as the Gumbel distribution.
+static const double kGumbelShapeTolerance = 1e-9;
+
+// The Euler-Mascheroni constant.
+static const double kEulerGamma = 0.57721566490153286;
+
+// The parameters are optimized as (mu, log(sigma), xi) so that the scale stays
+// positive.
+typedef Eigen::Vector3d GevParameters;
+typedef std::function<double(const GevParameters&)> GevObjective;
+
+// Minimizes the objective with the Nelder-Mead simplex method starting from
+// the given parameters.
+void MinimizeNelderMead(const GevObjective& objective,
+                        const GevParameters& initial_step,
+                        GevParameters* parameters) {
+  static const int kMaxIterations = 500;
+  static const double kFunctionTolerance = 1e-10;
+
+  Eigen::Matrix<double, 3, 4> simplex;
+  Eigen::Vector4d values;
+  simplex.col(0) = *parameters;
+  for (int i = 0; i < 3; i++) {
+    simplex.col(i + 1) = *parameters;
+    simplex(i, i + 1) += initial_step[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    values[i] = objective(simplex.col(i));
+  }
+
+  for (int iteration = 0; iteration < kMaxIterations; iteration++) {
+    // Order the vertices such that the first one is the best.
+    for (int i = 1; i < 4; i++) {
+      for (int j = i; j > 0 && values[j] < values[j - 1]; j--) {
+        std::swap(values[j], values[j - 1]);
+        simplex.col(j).swap(simplex.col(j - 1));
+      }
+    }
+    if (std::abs(values[3] - values[0]) <=
+        kFunctionTolerance * (std::abs(values[0]) + kFunctionTolerance)) {
+      break;
+    }
+
+    const GevParameters centroid = simplex.leftCols<3>().rowwise().mean();
+    const GevParameters reflected = 2.0 * centroid - simplex.col(3);
+    const double reflected_value = objective(reflected);
+    if (reflected_value < values[0]) {
+      const GevParameters expanded = 3.0 * centroid - 2.0 * simplex.col(3);
+      const double expanded_value = objective(expanded);
+      if (expanded_value < reflected_value) {
+        simplex.col(3) = expanded;
+        values[3] = expanded_value;
+      } else {
+        simplex.col(3) = reflected;
+        values[3] = reflected_value;
+      }
+      continue;
+    }
+    if (reflected_value < values[2]) {
+      simplex.col(3) = reflected;
+      values[3] = reflected_value;
+      continue;
+    }
+
+    const GevParameters contracted = 0.5 * (centroid + simplex.col(3));
+    const double contracted_value = objective(contracted);
+    if (contracted_value < values[3]) {
+      simplex.col(3) = contracted;
+      values[3] = contracted_value;
+      continue;
+    }
+
+    // Shrink the simplex towards the best vertex.
+    for (int i = 1; i < 4; i++) {
+      simplex.col(i) = 0.5 * (simplex.col(0) + simplex.col(i));
+      values[i] = objective(simplex.col(i));
+    }
+  }
+
+  int best_index;
+  values.minCoeff(&best_index);
+  *parameters = simplex.col(best_index);
+}
+
+// The negative log-likelihood of the sorted samples.
+double GevNegativeLogLikelihood(const std::vector<double>& samples,
+                                const GevParameters& parameters) {
+  const double mu = parameters[0];
+  const double sigma = std::exp(parameters[1]);
+  const double xi = parameters[2];
+  double negative_log_likelihood = samples.size() * parameters[1];
+  for (const double sample : samples) {
+    const double z = (sample - mu) / sigma;
+    if (std::abs(xi) < kGumbelShapeTolerance) {
+      negative_log_likelihood += z + std::exp(-z);
+      continue;
+    }
+    const double w = 1.0 + xi * z;
+    if (w <= 0.0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    const double log_w = std::log(w);
+    negative_log_likelihood += (1.0 + 1.0 / xi) * log_w + std::exp(-log_w / xi);
+  }
+  return negative_log_likelihood;
+}
+
+// The sum of squared differences between the sorted samples and the quantiles
+// of the distribution at the plotting positions (i + 0.5) / n.
+double GevQuantileSquaredError(const std::vector<double>& samples,
+                               const GevParameters& parameters) {
+  const double mu = parameters[0];
+  const double sigma = std::exp(parameters[1]);
+  const double xi = parameters[2];
+  double squared_error = 0.0;
+  for (int i = 0; i < samples.size(); i++) {
+    const double p = (i + 0.5) / samples.size();
+    const double log_p = -std::log(p);
+    const double quantile =
+        std::abs(xi) < kGumbelShapeTolerance
+            ? mu - sigma * std::log(log_p)
+            : mu + sigma * (std::pow(log_p, -xi) - 1.0) / xi;
+    squared_error += (quantile - samples[i]) * (quantile - samples[i]);
+  }
+  return squared_error;
+}
+
+// Closed form estimate from the probability weighted moments of the sorted
+// samples.
+bool FitGevProbabilityWeightedMoments(const std::vector<double>& samples,
+                                      double* mu,
+                                      double* sigma,
+                                      double* xi) {
+  const int n = samples.size();
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  for (int i = 0; i < n; i++) {
+    b0 += samples[i];
+    b1 += samples[i] * i / (n - 1.0);
+    b2 += samples[i] * i * (i - 1.0) / ((n - 1.0) * (n - 2.0));
+  }
+  b0 /= n;
+  b1 /= n;
+  b2 /= n;
+
+  // Hosking's shape k is the negated shape xi.
+  const double c = (2.0 * b1 - b0) / (3.0 * b2 - b0) - log(2.0) / log(3.0);
+  const double k = 7.8590 * c + 2.9554 * c * c;
+  if (std::abs(k) < kGumbelShapeTolerance) {
+    *sigma = (2.0 * b1 - b0) / log(2.0);
+    *mu = b0 - kEulerGamma * *sigma;
+    *xi = 0.0;
+  } else {
+    const double gamma_k = std::tgamma(1.0 + k);
+    *sigma = (2.0 * b1 - b0) * k / (gamma_k * (1.0 - std::pow(2.0, -k)));
+    *mu = b0 + *sigma * (gamma_k - 1.0) / k;
+    *xi = -k;
+  }
+  return std::isfinite(*mu) && std::isfinite(*xi) && *sigma > 0.0 &&
+         std::isfinite(*sigma);
+}
+
+}  // namespace
+
+double GevPdf(const double x,
+              const double mu,
+              const double sigma,
+              const double xi) {
+  const double z = (x - mu) / sigma;
+  if (std::abs(xi) < kGumbelShapeTolerance) {
+    const double t = std::exp(-z);
+    return t * std::exp(-t) / sigma;
+  }
+  const double w = 1.0 + xi * z;
+  if (w <= 0.0) {
+    return 0.0;
+  }
+  const double t = std::pow(w, -1.0 / xi);
+  return std::pow(t, xi + 1.0) * std::exp(-t) / sigma;
+}
+
+double GevCdf(const double x,
+              const double mu,
+              const double sigma,
+              const double xi) {
+  const double z = (x - mu) / sigma;
+  if (std::abs(xi) < kGumbelShapeTolerance) {
+    return std::exp(-std::exp(-z));
+  }
+  const double w = 1.0 + xi * z;
+  if (w <= 0.0) {
+    // Outside of the support: below the lower bound for a positive shape and
+    // above the upper bound for a negative one.
+    return xi > 0.0 ? 0.0 : 1.0;
+  }
+  return std::exp(-std::pow(w, -1.0 / xi));
+}
+
+bool FitGev(const std::vector<double>& samples,
+            const GevFittingMethod fitting_method,
+            double* mu,
+            double* sigma,
+            double* xi) {
+  CHECK_NOTNULL(mu);
+  CHECK_NOTNULL(sigma);
+  CHECK_NOTNULL(xi);
+  if (samples.size() < 3) {
+    return false;
+  }
+
+  std::vector<double> sorted_samples(samples);
+  std::sort(sorted_samples.begin(), sorted_samples.end());
+  if (!FitGevProbabilityWeightedMoments(sorted_samples, mu, sigma, xi)) {
+    return false;
+  }
+  if (fitting_method == PROBABILITY_WEIGHTED_MOMENTS) {
+    return true;
+  }
+
+  GevObjective objective;
+  if (fitting_method == MAXIMUM_LIKELIHOOD) {
+    objective = [&sorted_samples](const GevParameters& parameters) {
+      return GevNegativeLogLikelihood(sorted_samples, parameters);
+    };
+  } else {
+    objective = [&sorted_samples](const GevParameters& parameters) {
+      return GevQuantileSquaredError(sorted_samples, parameters);
+    };
+  }
+
+  GevParameters parameters(*mu, std::log(*sigma), *xi);
+  // The likelihood is infinite when a sample falls outside of the support, in
+  // which case the moments estimate is moved towards the Gumbel distribution
+  // whose support is unbounded.
+  if (!std::isfinite(objective(parameters))) {
+    parameters[2] = 0.0;
+  }
+  const GevParameters initial_step(0.1 * *sigma, 0.1, 0.05);
+  MinimizeNelderMead(objective, initial_step, &parameters);
+  if (!std::isfinite(objective(parameters))) {
+    return false;
+  }
+
+  *mu = parameters[0];
+  *sigma = std::exp(parameters[1]);
+  *xi = parameters[2];
+  return true;
+}
+
+}  // namespace theia
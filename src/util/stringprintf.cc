@@ -91,4 +91,12 @@ namespace theia
     return result;
   }
 
+  void StringAppendF(std::string *dst, const char *format, ...)
+  {
+    va_list ap;
+    va_start(ap, format);
+    StringAppendV(dst, format, ap);
+    va_end(ap);
+  }
+
 } // namespace theia
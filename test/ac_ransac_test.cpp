@@ -0,0 +1,72 @@
+//
+// Checks that AcRansac selects an inlier threshold that brackets the noise of
+// points on a line among uniform outliers, and that it finds no meaningful
+// model in pure outliers.
+//
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/ac_ransac.h>
+#include <theia/util/random.h>
+
+#include "line_estimator.h"
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const double size = 100.0;
+    const double sigma = 0.5;
+    // A uniformly drawn point is within eps of a line crossing the square with
+    // a probability of about 2 * eps / size.
+    const double alpha0 = 2.0 / size;
+
+    theia::RansacParameters ransac_params;
+    ransac_params.error_thresh = 0.2 * size;
+    ransac_params.max_iterations = 1000;
+    synthetic_lines::LineEstimator estimator;
+    theia::AcRansac< synthetic_lines::LineEstimator > ac_ransac(
+        ransac_params, estimator, alpha0 );
+    ac_ransac.Initialize();
+
+    // The distances of the inliers are half normal, with 95% of them below
+    // 1.96 sigma. The threshold should keep most of them without reaching far
+    // into the outliers.
+    bool success = true;
+    for ( int trial = 0; trial < 5; ++trial )
+    {
+        vector< Eigen::Vector2d > points;
+        synthetic_lines::AddLinePoints(
+            synthetic_lines::Line( Eigen::Vector2d( 50.0, 50.0 ),
+                                   theia::RandDouble( 0.0, M_PI ) ),
+            200, sigma, size, &points );
+        synthetic_lines::AddUniformPoints( 200, size, &points );
+
+        Eigen::Vector3d line;
+        theia::RansacSummary summary;
+        const bool found = ac_ransac.Estimate( points, &line, &summary );
+        const double threshold = ac_ransac.InlierThreshold();
+        cout << "trial " << trial << ": threshold " << threshold << ", "
+             << summary.inliers.size() << " inliers" << endl;
+        success = success && found && threshold > sigma &&
+                  threshold < 5.0 * sigma && summary.inliers.size() >= 180;
+    }
+
+    // No line is meaningful in uniformly drawn points.
+    vector< Eigen::Vector2d > outliers;
+    synthetic_lines::AddUniformPoints( 400, size, &outliers );
+    Eigen::Vector3d line;
+    theia::RansacSummary summary;
+    const bool found_in_outliers =
+        ac_ransac.Estimate( outliers, &line, &summary );
+    cout << "outliers:" << ( found_in_outliers ? "model" : "no model" )
+         << endl;
+    success = success && !found_in_outliers && summary.inliers.empty();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
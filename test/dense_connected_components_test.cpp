@@ -0,0 +1,108 @@
+//
+// Checks that DenseConnectedComponents partitions random graphs like
+// ConnectedComponents, both edge by edge and through AddEdges, which is split
+// across threads with OpenMP.
+//
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// theia
+#include <theia/math/graph/connected_components.h>
+#include <theia/math/graph/dense_connected_components.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+namespace {
+// Returns true if the components extracted from dense_components are the
+// components of reference, and every node that is not on any edge is a
+// component of its own. Also checks the order of the extracted components and
+// the labels.
+bool SamePartition( theia::ConnectedComponents< int > *reference,
+                    theia::DenseConnectedComponents *dense_components )
+{
+    unordered_map< int, unordered_set< int > > reference_components;
+    reference->Extract( &reference_components );
+    // The reference component of each node on an edge.
+    unordered_map< int, const unordered_set< int > * > reference_component;
+    for ( const auto &component : reference_components )
+    {
+        for ( const int node : component.second )
+        {
+            reference_component[node] = &component.second;
+        }
+    }
+
+    vector< int > offsets, nodes, labels;
+    dense_components->Extract( &offsets, &nodes, &labels );
+    if ( nodes.size() != dense_components->NumNodes() ||
+         labels.size() != dense_components->NumNodes() )
+    {
+        return false;
+    }
+    for ( int c = 0; c + 1 < offsets.size(); ++c )
+    {
+        const int first_node = nodes[offsets[c]];
+        if ( c > 0 && first_node < nodes[offsets[c - 1]] )
+        {
+            return false;
+        }
+        const auto it = reference_component.find( first_node );
+        const int size = offsets[c + 1] - offsets[c];
+        if ( it == reference_component.end() ? size != 1
+                                             : size != it->second->size() )
+        {
+            return false;
+        }
+        for ( int k = offsets[c]; k < offsets[c + 1]; ++k )
+        {
+            if ( labels[nodes[k]] != c ||
+                 ( k > offsets[c] && nodes[k] <= nodes[k - 1] ) ||
+                 ( it != reference_component.end() &&
+                   it->second->count( nodes[k] ) == 0 ) )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}  // namespace
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const int num_nodes = 1000;
+    bool success = true;
+    // Sparse graphs leave many small components and isolated nodes, dense
+    // ones merge almost everything. AddEdges only uses several threads when
+    // there are more edges than nodes per thread.
+    for ( const int num_edges : { 100, 600, 900, 5000, 20000 } )
+    {
+        vector< pair< int, int > > edges( num_edges );
+        theia::ConnectedComponents< int > reference;
+        theia::DenseConnectedComponents edge_by_edge( num_nodes );
+        theia::DenseConnectedComponents batch( num_nodes );
+        for ( pair< int, int > &edge : edges )
+        {
+            edge.first = theia::RandInt( 0, num_nodes - 1 );
+            edge.second = theia::RandInt( 0, num_nodes - 1 );
+            reference.AddEdge( edge.first, edge.second );
+            edge_by_edge.AddEdge( edge.first, edge.second );
+        }
+        batch.AddEdges( edges );
+
+        const bool same = SamePartition( &reference, &edge_by_edge ) &&
+                          SamePartition( &reference, &batch );
+        cout << num_edges << " edges:" << ( same ? "same" : "different" )
+             << endl;
+        success = success && same;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+//
+// Checks that repeated calls to Estimate do not allocate memory once the
+// estimation workspace has grown to the size of the data.
+//
+
+// STL
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <vector>
+#ifdef THEIA_USE_OPENMP
+#include <omp.h>
+#endif
+
+// theia
+#include <theia/solvers/ransac.h>
+
+// P3P
+#include "ransac_estimators.h"
+
+using namespace std;
+
+namespace {
+// Number of calls to the global allocation functions.
+size_t num_allocations = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+  ++num_allocations;
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+int main()
+{
+    // load data
+    ifstream ifs("../test/data.txt", ifstream::in );
+    assert( ifs.is_open() );
+    int n, n_inliers;
+    ifs >> n >> n_inliers;
+    vector< ransac_estimators::Match2D3D > data( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y;
+        ifs >> x >> y;
+        data[i].featureVector = Eigen::Vector3d( x, y, 1.0 ).normalized();
+    }
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y, z;
+        ifs >> x >> y >> z;
+        data[i].worldPoint = Eigen::Vector3d( x, y, z );
+    }
+    ifs.close();
+
+    ransac_estimators::RansacParameters ransac_params;
+    ransac_params.error_thresh = 1e-2;
+    ransac_params.failure_probability = 0.05;
+    ransac_params.max_iterations = 3000;
+    ransac_params.min_inlier_ratio = 0.1;
+
+    ransac_estimators::P3PEstimator estimator;
+    ransac_estimators::Ransac< ransac_estimators::P3PEstimator > ransac(ransac_params, estimator);
+    ransac.Initialize();
+    ransac_estimators::RansacSummary summary;
+    Eigen::Matrix< double, 3, 4 > best_model;
+
+    // The first call grows the workspace and the summary to the size of the
+    // data.
+    ransac.Estimate( data, &best_model, &summary );
+
+    // Every following call must run without a single allocation.
+    const size_t allocations_before = num_allocations;
+    for ( int i = 0; i < 10; ++i )
+    {
+        ransac.Estimate( data, &best_model, &summary );
+    }
+    const size_t steady_state_allocations = num_allocations - allocations_before;
+
+    cout << "inliers:" << summary.inliers.size() << endl;
+    cout << "steady state allocations:" << steady_state_allocations << endl;
+
+    // A small dataset has few enough minimal samples to evaluate all of them,
+    // which must not allocate either when it runs on a single thread.
+#ifdef THEIA_USE_OPENMP
+    omp_set_num_threads( 1 );
+#endif
+    ransac_params.use_exhaustive_enumeration = true;
+    const vector< ransac_estimators::Match2D3D > small_data( data.begin(), data.begin() + 25 );
+    ransac.Estimate( small_data, &best_model, &summary );
+    const size_t exhaustive_allocations_before = num_allocations;
+    for ( int i = 0; i < 10; ++i )
+    {
+        ransac.Estimate( small_data, &best_model, &summary );
+    }
+    const size_t exhaustive_allocations = num_allocations - exhaustive_allocations_before;
+
+    cout << "exhaustive iterations:" << summary.num_iterations << endl;
+    cout << "exhaustive inliers:" << summary.inliers.size() << endl;
+    cout << "exhaustive steady state allocations:" << exhaustive_allocations << endl;
+
+    // The sample cache is preallocated by the first call, and skipping the
+    // repeated samples must not allocate either.
+    ransac_params.use_exhaustive_enumeration = false;
+    ransac_params.use_sample_cache = true;
+    ransac.Estimate( data, &best_model, &summary );
+    const size_t cache_allocations_before = num_allocations;
+    for ( int i = 0; i < 10; ++i )
+    {
+        ransac.Estimate( data, &best_model, &summary );
+    }
+    const size_t cache_allocations = num_allocations - cache_allocations_before;
+
+    cout << "sample cache steady state allocations:" << cache_allocations << endl;
+    return steady_state_allocations == 0 && exhaustive_allocations == 0 &&
+           cache_allocations == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,137 @@
+//
+// Checks that the uniform and log-uniform histograms, filled value by value
+// and with AddBatch, count the same values in every bin as a histogram with
+// the same boundaries given explicitly, including zero, the boundaries, the
+// largest value, infinite values and NaN.
+//
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+// theia
+#include <theia/math/histogram.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+namespace {
+// Returns true if both histograms count the same values in every bin and all
+// of the num_values values are counted.
+template < typename T >
+bool SameCounts( const theia::Histogram< T > &histogram,
+                 const theia::Histogram< T > &reference,
+                 const int num_values )
+{
+    if ( histogram.NumBins() != reference.NumBins() )
+    {
+        return false;
+    }
+    int num_counted = 0;
+    for ( int i = 0; i < histogram.NumBins(); ++i )
+    {
+        if ( histogram.BinCount( i ) != reference.BinCount( i ) )
+        {
+            return false;
+        }
+        num_counted += histogram.BinCount( i );
+    }
+    return num_counted == num_values;
+}
+
+// Fills the histogram, a copy of it filled with AddBatch and a histogram with
+// the same explicit boundaries with the values, and compares their counts.
+template < typename T >
+bool CheckHistogram( const char *name,
+                     const theia::Histogram< T > &empty_histogram,
+                     const vector< T > &values )
+{
+    vector< T > boundaries;
+    for ( int i = 0; i + 1 < empty_histogram.NumBins(); ++i )
+    {
+        boundaries.push_back( empty_histogram.Boundary( i ) );
+    }
+    theia::Histogram< T > reference( boundaries );
+    theia::Histogram< T > histogram( empty_histogram );
+    theia::Histogram< T > batch_histogram( empty_histogram );
+    for ( const T value : values )
+    {
+        reference.Add( value );
+        histogram.Add( value );
+    }
+    batch_histogram.AddBatch( values.data(), values.size() );
+
+    const bool same = SameCounts( histogram, reference, values.size() ) &&
+                      SameCounts( batch_histogram, reference, values.size() );
+    cout << name << ":" << ( same ? "same" : "different" ) << endl;
+    return same;
+}
+
+// Random values around [min_value, max_value], the boundaries of the
+// histogram and the special values of the type.
+template < typename T >
+vector< T > TestValues( const theia::Histogram< T > &histogram,
+                        const double min_value,
+                        const double max_value )
+{
+    vector< T > values;
+    const double range = max_value - min_value;
+    for ( int i = 0; i < 10000; ++i )
+    {
+        values.push_back( static_cast< T >( theia::RandDouble(
+            min_value - 0.2 * range, max_value + 0.2 * range ) ) );
+    }
+    for ( int i = 0; i + 1 < histogram.NumBins(); ++i )
+    {
+        values.push_back( histogram.Boundary( i ) );
+    }
+    values.push_back( 0 );
+    values.push_back( numeric_limits< T >::max() );
+    values.push_back( numeric_limits< T >::lowest() );
+    if ( numeric_limits< T >::has_infinity )
+    {
+        values.push_back( numeric_limits< T >::infinity() );
+        values.push_back( -numeric_limits< T >::infinity() );
+    }
+    if ( numeric_limits< T >::has_quiet_NaN )
+    {
+        values.push_back( numeric_limits< T >::quiet_NaN() );
+    }
+    return values;
+}
+}  // namespace
+
+int main()
+{
+    theia::InitRandomGenerator();
+    bool success = true;
+
+    const theia::Histogram< double > uniform =
+        theia::Histogram< double >::Uniform( -1.0, 3.0, 17 );
+    success &= CheckHistogram( "uniform", uniform,
+                               TestValues( uniform, -1.0, 3.0 ) );
+
+    const theia::Histogram< double > log_uniform =
+        theia::Histogram< double >::LogUniform( 1e-4, 1e-1, 25 );
+    success &= CheckHistogram( "log uniform", log_uniform,
+                               TestValues( log_uniform, 1e-4, 1e-1 ) );
+
+    const theia::Histogram< int > int_uniform =
+        theia::Histogram< int >::Uniform( 0, 1000, 7 );
+    success &= CheckHistogram( "int uniform", int_uniform,
+                               TestValues( int_uniform, 0, 1000 ) );
+
+    // NaN is counted above the last boundary.
+    const double nan = numeric_limits< double >::quiet_NaN();
+    theia::Histogram< double > nan_histogram( uniform );
+    nan_histogram.Add( nan );
+    nan_histogram.AddBatch( &nan, 1 );
+    const bool nan_overflows =
+        nan_histogram.BinCount( nan_histogram.NumBins() - 1 ) == 2;
+    cout << "nan:" << ( nan_overflows ? "overflow" : "wrong bin" ) << endl;
+    success &= nan_overflows;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+//
+// Checks that IncrementalRansac keeps the inliers of its best model up to date
+// as data is added, i.e. that they match a full rescore of the best model on
+// all of the data, that improvements are reported to the progress callback,
+// and that the estimation stops once it is cancelled.
+//
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/incremental_ransac.h>
+#include <theia/util/random.h>
+
+// P3P
+#include "ransac_estimators.h"
+
+using namespace std;
+
+int main()
+{
+    // load data
+    ifstream ifs("../test/data.txt", ifstream::in );
+    assert( ifs.is_open() );
+    int n, n_inliers;
+    ifs >> n >> n_inliers;
+    vector< ransac_estimators::Match2D3D > data( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y;
+        ifs >> x >> y;
+        data[i].featureVector = Eigen::Vector3d( x, y, 1.0 ).normalized();
+    }
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y, z;
+        ifs >> x >> y >> z;
+        data[i].worldPoint = Eigen::Vector3d( x, y, z );
+    }
+    ifs.close();
+
+    // The inliers come first in the file, so spread them over the tiles.
+    theia::InitRandomGenerator();
+    for ( int i = n - 1; i > 0; --i )
+    {
+        swap( data[i], data[theia::RandInt( 0, i )] );
+    }
+
+    ransac_estimators::RansacParameters ransac_params;
+    ransac_params.error_thresh = 1e-2;
+    ransac_params.max_iterations = 3000;
+    ransac_params.use_sample_cache = true;
+
+    ransac_estimators::P3PEstimator estimator;
+    theia::IncrementalRansac< ransac_estimators::P3PEstimator > ransac(
+        ransac_params, estimator );
+    ransac.Initialize();
+    int num_progress_reports = 0;
+    double last_reported_confidence = 0.0;
+    ransac.SetProgressCallback(
+        [&]( const Eigen::Matrix< double, 3, 4 > &model,
+             const double inlier_ratio, const double confidence ) {
+            ++num_progress_reports;
+            last_reported_confidence = confidence;
+        } );
+
+    // Add the data in tiles, with a few iterations in between, and compare
+    // the inliers of the best model after each tile with a full rescore.
+    const int tile_size = 20;
+    int num_mismatches = 0;
+    Eigen::Matrix< double, 3, 4 > best_model;
+    ransac_estimators::RansacSummary summary;
+    for ( int begin = 0; begin < n; begin += tile_size )
+    {
+        const int end = min( n, begin + tile_size );
+        ransac.AddCorrespondences( vector< ransac_estimators::Match2D3D >(
+            data.begin() + begin, data.begin() + end ) );
+        if ( ransac.CurrentBest( &best_model, &summary ) )
+        {
+            const vector< double > residuals =
+                estimator.Residuals( ransac.Data(), best_model );
+            int num_inliers = 0;
+            for ( const double residual : residuals )
+            {
+                if ( residual < ransac_params.error_thresh )
+                {
+                    ++num_inliers;
+                }
+            }
+            // The confidence is computed from the incrementally updated
+            // number of inliers.
+            const double inlier_ratio =
+                static_cast< double >( num_inliers ) / end;
+            const double confidence =
+                1.0 - pow( 1.0 - pow( inlier_ratio, estimator.SampleSize() ),
+                           summary.num_iterations );
+            if ( summary.inliers.size() != num_inliers ||
+                 abs( summary.confidence - confidence ) > 1e-12 )
+            {
+                ++num_mismatches;
+            }
+        }
+        ransac.RunIterations( 10 );
+    }
+    while ( !ransac.Converged() )
+    {
+        ransac.RunIterations( 10 );
+    }
+    ransac.CurrentBest( &best_model, &summary );
+    const int num_final_inliers = summary.inliers.size();
+    cout << "iterations:" << summary.num_iterations << endl;
+    cout << "inliers:" << num_final_inliers << endl;
+    cout << "mismatches:" << num_mismatches << endl;
+    cout << "progress reports:" << num_progress_reports << endl;
+    const bool reported = num_progress_reports > 0 &&
+                          last_reported_confidence > 0.0 &&
+                          last_reported_confidence <= 1.0;
+
+    // A cancelled estimation runs no iterations and has converged.
+    atomic< bool > cancelled( true );
+    ransac.SetCancellationFlag( &cancelled );
+    ransac.Reset();
+    ransac.AddCorrespondences( data );
+    const int num_cancelled_iterations = ransac.RunIterations( 10 );
+    cout << "iterations after cancellation:" << num_cancelled_iterations
+         << endl;
+    const bool stopped = num_cancelled_iterations == 0 && ransac.Converged();
+
+    return num_mismatches == 0 && num_final_inliers >= n_inliers && stopped &&
+                   reported
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
@@ -0,0 +1,116 @@
+//
+// Checks IndexedPriorityQueue against a std::set of (value, key) pairs over a
+// long sequence of random insertions, updates, erasures and pops.
+//
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+// theia
+#include <theia/util/indexed_priority_queue.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const int num_operations = 200000;
+    const int num_keys = 1000;
+    // Few distinct values, so that many entries tie.
+    const int max_value = 100;
+
+    theia::IndexedPriorityQueue< int > queue;
+    queue.reserve( num_keys / 2 );
+    set< pair< int, int > > reference;
+    vector< int > values( num_keys, -1 );
+    int num_mismatches = 0;
+    for ( int i = 0; i < num_operations; ++i )
+    {
+        const int key = theia::RandInt( 0, num_keys - 1 );
+        const int value = theia::RandInt( 0, max_value );
+        switch ( theia::RandInt( 0, 4 ) )
+        {
+        case 0:
+        case 1:
+            if ( values[key] < 0 )
+            {
+                queue.insert( key, value );
+            }
+            else
+            {
+                queue.update( key, value );
+                reference.erase( make_pair( values[key], key ) );
+            }
+            reference.insert( make_pair( value, key ) );
+            values[key] = value;
+            break;
+        case 2:
+            queue.erase( key );
+            if ( values[key] >= 0 )
+            {
+                reference.erase( make_pair( values[key], key ) );
+                values[key] = -1;
+            }
+            break;
+        case 3:
+            if ( !queue.empty() )
+            {
+                // Any of the keys with the smallest value may be on top.
+                const pair< int, int > top = queue.top();
+                if ( top.second != reference.begin()->first ||
+                     values[top.first] != top.second )
+                {
+                    ++num_mismatches;
+                }
+                queue.pop();
+                reference.erase( make_pair( top.second, top.first ) );
+                values[top.first] = -1;
+            }
+            break;
+        default:
+            if ( queue.contains( key ) != ( values[key] >= 0 ) ||
+                 ( values[key] >= 0 && queue.find( key ) != values[key] ) )
+            {
+                ++num_mismatches;
+            }
+            // Rarely start over, which keeps the reserved memory.
+            if ( theia::RandInt( 0, 9999 ) == 0 )
+            {
+                queue.clear();
+                reference.clear();
+                values.assign( num_keys, -1 );
+            }
+            break;
+        }
+        if ( queue.size() != reference.size() )
+        {
+            ++num_mismatches;
+        }
+    }
+
+    // Popping everything must return the values in order.
+    int previous_value = -1;
+    while ( !queue.empty() )
+    {
+        const pair< int, int > top = queue.top();
+        if ( top.second < previous_value ||
+             reference.erase( make_pair( top.second, top.first ) ) != 1 )
+        {
+            ++num_mismatches;
+        }
+        previous_value = top.second;
+        queue.pop();
+    }
+    if ( !reference.empty() )
+    {
+        ++num_mismatches;
+    }
+
+    cout << "mismatches:" << num_mismatches << endl;
+    return num_mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,103 @@
+//
+// A 2D line estimator and synthetic point sets, for the tests of the sample
+// consensus estimators that need data with a known noise level or several
+// planted models.
+//
+
+#pragma once
+// STL
+#include <cmath>
+#include <vector>
+
+// theia
+#include <theia/solvers/static_estimator.h>
+#include <theia/util/random.h>
+
+// eigen
+#include <Eigen/Core>
+
+namespace synthetic_lines
+{
+// A line is given by (a, b, c) with a^2 + b^2 = 1, so that the residual of a
+// point (x, y) is its distance |a * x + b * y + c| to the line. The
+// residuals are not squared, so that the probability of a uniformly drawn
+// point to be within eps of a line is proportional to eps.
+class LineEstimator
+    : public theia::StaticEstimator< LineEstimator, Eigen::Vector2d,
+                                     Eigen::Vector3d >
+{
+public:
+    double SampleSize() const { return 2; }
+
+    bool EstimateModel( const std::vector< Eigen::Vector2d > &data,
+                        std::vector< Eigen::Vector3d > *models ) const
+    {
+        const Eigen::Vector2d direction( data[1] - data[0] );
+        const double length = direction.norm();
+        if ( length < 1e-12 )
+        {
+            return false;
+        }
+        const Eigen::Vector2d normal( -direction( 1 ) / length,
+                                      direction( 0 ) / length );
+        models->assign( 1, Eigen::Vector3d( normal( 0 ), normal( 1 ),
+                                            -normal.dot( data[0] ) ) );
+        return true;
+    }
+
+    double Error( const Eigen::Vector2d &point,
+                  const Eigen::Vector3d &line ) const
+    {
+        return std::abs( line( 0 ) * point( 0 ) + line( 1 ) * point( 1 ) +
+                         line( 2 ) );
+    }
+};
+
+// The line through the point at the given angle of its direction.
+inline Eigen::Vector3d Line( const Eigen::Vector2d &point, const double angle )
+{
+    const Eigen::Vector2d normal( -std::sin( angle ), std::cos( angle ) );
+    return Eigen::Vector3d( normal( 0 ), normal( 1 ), -normal.dot( point ) );
+}
+
+// Appends num_points points of the line within the square [0, size]^2,
+// displaced along the normal of the line by Gaussian noise of standard
+// deviation sigma.
+inline void AddLinePoints( const Eigen::Vector3d &line,
+                           const int num_points,
+                           const double sigma,
+                           const double size,
+                           std::vector< Eigen::Vector2d > *points )
+{
+    const Eigen::Vector2d normal( line( 0 ), line( 1 ) );
+    const Eigen::Vector2d direction( -normal( 1 ), normal( 0 ) );
+    const Eigen::Vector2d center( size / 2.0, size / 2.0 );
+    // The point of the line closest to the center of the square.
+    const Eigen::Vector2d origin( center - line.dot( Eigen::Vector3d(
+                                      center( 0 ), center( 1 ), 1.0 ) ) *
+                                      normal );
+    const size_t num_total_points = points->size() + num_points;
+    while ( points->size() < num_total_points )
+    {
+        const Eigen::Vector2d point(
+            origin + theia::RandDouble( -size, size ) * direction +
+            theia::RandGaussian( 0.0, sigma ) * normal );
+        if ( point.minCoeff() >= 0.0 && point.maxCoeff() <= size )
+        {
+            points->push_back( point );
+        }
+    }
+}
+
+// Appends num_points points drawn uniformly in the square [0, size]^2.
+inline void AddUniformPoints( const int num_points,
+                              const double size,
+                              std::vector< Eigen::Vector2d > *points )
+{
+    for ( int i = 0; i < num_points; ++i )
+    {
+        points->emplace_back( theia::RandDouble( 0.0, size ),
+                              theia::RandDouble( 0.0, size ) );
+    }
+}
+}  // namespace synthetic_lines
@@ -0,0 +1,109 @@
+//
+// Checks that the loss of MagsacQualityMeasurement matches a direct evaluation
+// of the marginalized loss for residuals with two degrees of freedom, and that
+// it increases with the residual from 0 to 1 at the maximum threshold.
+//
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/magsac_quality_measurement.h>
+
+using namespace std;
+
+namespace {
+// The loss of a squared residual with two degrees of freedom. The incomplete
+// gamma functions of orders 3/2 and 1/2 have closed forms in terms of erf:
+//   gamma(1/2, u) = sqrt(pi) * erf(sqrt(u)),
+//   Gamma(1/2, u) = sqrt(pi) * erfc(sqrt(u)),
+//   gamma(3/2, u) = gamma(1/2, u) / 2 - sqrt(u) * exp(-u).
+double DirectLoss( const double residual, const double error_thresh )
+{
+    // The 0.99 quantile of the chi-squared distribution with two degrees of
+    // freedom.
+    const double k_squared = -2.0 * log( 0.01 );
+    if ( residual >= error_thresh )
+    {
+        return 1.0;
+    }
+    const double max_u = 0.5 * k_squared;
+    const double u = residual / error_thresh * max_u;
+    const double sqrt_pi = sqrt( M_PI );
+    const auto lower_gamma = [&]( const double x ) {
+        return 0.5 * sqrt_pi * erf( sqrt( x ) ) - sqrt( x ) * exp( -x );
+    };
+    const auto upper_gamma = [&]( const double x ) {
+        return sqrt_pi * erfc( sqrt( x ) );
+    };
+    return ( lower_gamma( u ) +
+             u * ( upper_gamma( u ) - upper_gamma( max_u ) ) ) /
+           lower_gamma( max_u );
+}
+
+// The loss of a single residual.
+double Loss( theia::MagsacQualityMeasurement *quality_measurement,
+             const double residual )
+{
+    return quality_measurement->ComputeCost( vector< double >( 1, residual ) );
+}
+
+// Returns true if the loss increases from 0 at a zero residual to 1 at the
+// threshold and stays 1 beyond it.
+bool CheckMonotone( const int degrees_of_freedom, const double error_thresh )
+{
+    theia::MagsacQualityMeasurement quality_measurement( error_thresh,
+                                                         degrees_of_freedom );
+    quality_measurement.Initialize();
+    const int num_steps = 10000;
+    double previous_loss = Loss( &quality_measurement, 0.0 );
+    bool monotone = previous_loss == 0.0;
+    for ( int i = 1; i <= num_steps; ++i )
+    {
+        const double residual = 1.5 * error_thresh * i / num_steps;
+        const double loss = Loss( &quality_measurement, residual );
+        if ( loss < previous_loss - 1e-12 || loss > 1.0 + 1e-12 )
+        {
+            monotone = false;
+        }
+        previous_loss = loss;
+    }
+    const double loss_at_threshold =
+        Loss( &quality_measurement, error_thresh * ( 1.0 - 1e-9 ) );
+    monotone = monotone && abs( loss_at_threshold - 1.0 ) < 1e-3 &&
+               Loss( &quality_measurement, 2.0 * error_thresh ) == 1.0;
+    cout << "degrees of freedom " << degrees_of_freedom << ":"
+         << ( monotone ? "monotone" : "not monotone" ) << endl;
+    return monotone;
+}
+}  // namespace
+
+int main()
+{
+    bool success = true;
+    const double error_thresh = 4.0;
+
+    theia::MagsacQualityMeasurement quality_measurement( error_thresh );
+    quality_measurement.Initialize();
+    double max_difference = 0.0;
+    for ( const double residual :
+          { 0.0, 1e-3, 0.05, 0.3, 1.0, 1.7, 2.5, 3.2, 3.9, 4.0, 6.0 } )
+    {
+        const double loss = Loss( &quality_measurement, residual );
+        const double direct_loss = DirectLoss( residual, error_thresh );
+        cout << "residual " << residual << ": loss " << loss << ", direct "
+             << direct_loss << endl;
+        max_difference = max( max_difference, abs( loss - direct_loss ) );
+    }
+    // The tables are looked up at the nearest of 4096 entries.
+    success &= max_difference < 1e-4;
+
+    success &= CheckMonotone( 2, error_thresh );
+    success &= CheckMonotone( 4, 1e-2 );
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+//
+// Checks that MlesacQualityMeasurement recovers the inlier ratio of synthetic
+// squared residuals: inliers with Gaussian noise in both coordinates and
+// uniformly distributed outliers.
+//
+
+// STL
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/mlesac_quality_measurement.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const double error_thresh = 1e-2;
+    // The noise level at which error_thresh is the 95% quantile of the inlier
+    // residuals.
+    const double sigma = sqrt( error_thresh / 5.991465 );
+    const double outlier_range = 10.0 * error_thresh;
+    const int num_residuals = 20000;
+
+    bool success = true;
+    for ( const double inlier_ratio : { 0.1, 0.3, 0.6, 0.9 } )
+    {
+        const int num_inliers = inlier_ratio * num_residuals;
+        vector< double > residuals( num_residuals );
+        int num_thresholded_inliers = 0;
+        for ( int i = 0; i < num_residuals; ++i )
+        {
+            if ( i < num_inliers )
+            {
+                const double dx = theia::RandGaussian( 0.0, sigma );
+                const double dy = theia::RandGaussian( 0.0, sigma );
+                residuals[i] = dx * dx + dy * dy;
+            }
+            else
+            {
+                residuals[i] = theia::RandDouble( 0.0, outlier_range );
+            }
+            if ( residuals[i] < error_thresh )
+            {
+                ++num_thresholded_inliers;
+            }
+        }
+
+        // With enough EM iterations, the mixing ratio converges to the
+        // maximum likelihood estimate, which is only off by the sampling noise
+        // if the inlier density is right. The default number of iterations
+        // stops short of convergence.
+        theia::MlesacQualityMeasurement converged_quality_measurement(
+            error_thresh, sigma, outlier_range, 200 );
+        theia::MlesacQualityMeasurement quality_measurement( error_thresh );
+        converged_quality_measurement.Initialize();
+        quality_measurement.Initialize();
+        converged_quality_measurement.ComputeCost( residuals );
+        quality_measurement.ComputeCost( residuals );
+        const double converged_ratio =
+            converged_quality_measurement.mixing_ratio();
+        const double estimated_ratio = quality_measurement.mixing_ratio();
+        // Thresholding counts the outliers below the threshold as inliers,
+        // while the mixture accounts for them.
+        const double thresholded_ratio =
+            static_cast< double >( num_thresholded_inliers ) / num_residuals;
+        cout << "inlier ratio " << inlier_ratio << ": mlesac "
+             << converged_ratio << " (" << estimated_ratio << " by default)"
+             << ", threshold " << thresholded_ratio << endl;
+        success = success && abs( converged_ratio - inlier_ratio ) < 0.015 &&
+                  abs( estimated_ratio - inlier_ratio ) < 0.03;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
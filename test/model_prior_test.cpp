@@ -0,0 +1,113 @@
+//
+// Checks that a PosePrior rejects the initial models of
+// EstimateWithInitialModels that are inconsistent with it, counting them as
+// prior rejected models, and that the estimation then keeps to the prior.
+//
+
+// STL
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/util/random.h>
+
+// P3P
+#include "ransac_estimators.h"
+
+using namespace std;
+
+int main()
+{
+    // load data
+    ifstream ifs("../test/data.txt", ifstream::in );
+    assert( ifs.is_open() );
+    int n, n_inliers;
+    ifs >> n >> n_inliers;
+    vector< ransac_estimators::Match2D3D > data( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y;
+        ifs >> x >> y;
+        data[i].featureVector = Eigen::Vector3d( x, y, 1.0 ).normalized();
+    }
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y, z;
+        ifs >> x >> y >> z;
+        data[i].worldPoint = Eigen::Vector3d( x, y, z );
+    }
+    ifs.close();
+    theia::InitRandomGenerator();
+
+    ransac_estimators::RansacParameters ransac_params;
+    ransac_params.error_thresh = 1e-2;
+    ransac_params.max_iterations = 3000;
+    ransac_estimators::P3PEstimator estimator;
+    ransac_estimators::Ransac< ransac_estimators::P3PEstimator > ransac(
+        ransac_params, estimator );
+    ransac.Initialize();
+
+    // The pose estimated without a prior, and the same pose rotated by 90
+    // degrees about the optical axis, which the prior rules out.
+    Eigen::Matrix< double, 3, 4 > pose;
+    ransac_estimators::RansacSummary summary;
+    ransac.Estimate( data, &pose, &summary );
+    cout << "inliers without a prior:" << summary.inliers.size() << endl;
+    if ( summary.inliers.size() < n_inliers )
+    {
+        return EXIT_FAILURE;
+    }
+    Eigen::Matrix< double, 3, 4 > rotated_pose( pose );
+    rotated_pose.block< 3, 3 >( 0, 0 ) =
+        pose.block< 3, 3 >( 0, 0 ) *
+        Eigen::AngleAxisd( M_PI / 2.0, Eigen::Vector3d::UnitZ() ).matrix();
+    const ransac_estimators::PosePrior prior( pose, 0.2, 0.5 );
+    bool success = true;
+
+    // Without sampling, only the initial models are evaluated: the rotated
+    // pose is rejected and the consistent one is returned.
+    ransac_params.min_iterations = 0;
+    ransac_params.max_iterations = 0;
+    ransac.SetModelPrior( &prior );
+    Eigen::Matrix< double, 3, 4 > best_model;
+    vector< Eigen::Matrix< double, 3, 4 > > initial_models;
+    initial_models.push_back( rotated_pose );
+    initial_models.push_back( pose );
+    ransac.EstimateWithInitialModels( data, initial_models, &best_model,
+                                      &summary );
+    cout << "prior rejected initial models:"
+         << summary.num_prior_rejected_models << endl;
+    success = success && summary.num_prior_rejected_models == 1 &&
+              best_model == pose && summary.inliers.size() >= n_inliers;
+
+    // No model is left if every initial model is rejected.
+    initial_models.assign( 1, rotated_pose );
+    ransac.EstimateWithInitialModels( data, initial_models, &best_model,
+                                      &summary );
+    success = success && summary.num_prior_rejected_models == 1 &&
+              summary.inliers.empty();
+
+    // Without the prior, the rotated pose is scored.
+    ransac.SetModelPrior( nullptr );
+    ransac.EstimateWithInitialModels( data, initial_models, &best_model,
+                                      &summary );
+    success = success && summary.num_prior_rejected_models == 0 &&
+              best_model == rotated_pose;
+
+    // With sampling, the rejected initial model does not prevent finding the
+    // pose, which is consistent with the prior.
+    ransac_params.min_iterations = 100;
+    ransac_params.max_iterations = 3000;
+    ransac.SetModelPrior( &prior );
+    ransac.EstimateWithInitialModels( data, initial_models, &best_model,
+                                      &summary );
+    cout << "inliers with the prior:" << summary.inliers.size() << endl;
+    success = success && prior.IsConsistent( best_model ) &&
+              summary.inliers.size() >= n_inliers;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
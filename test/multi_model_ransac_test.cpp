@@ -0,0 +1,101 @@
+//
+// Checks that MultiModelRansac finds both lines planted among uniform outliers,
+// each with the points of its own line, and that their inlier sets are
+// disjoint.
+//
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/multi_model_ransac.h>
+#include <theia/util/random.h>
+
+#include "line_estimator.h"
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const double size = 100.0;
+    const int num_line_points = 100;
+    const Eigen::Vector2d anchors[2] = { Eigen::Vector2d( 50.0, 40.0 ),
+                                         Eigen::Vector2d( 40.0, 50.0 ) };
+    const Eigen::Vector3d lines[2] = {
+        synthetic_lines::Line( anchors[0], 0.2 ),
+        synthetic_lines::Line( anchors[1], 1.7 ) };
+    vector< Eigen::Vector2d > points;
+    synthetic_lines::AddLinePoints( lines[0], num_line_points, 0.1, size,
+                                    &points );
+    synthetic_lines::AddLinePoints( lines[1], num_line_points, 0.1, size,
+                                    &points );
+    synthetic_lines::AddUniformPoints( 100, size, &points );
+
+    theia::RansacParameters ransac_params;
+    ransac_params.error_thresh = 0.5;
+    synthetic_lines::LineEstimator estimator;
+    theia::MultiModelRansac< synthetic_lines::LineEstimator > ransac(
+        ransac_params, estimator, 3, 30 );
+    ransac.Initialize();
+
+    vector< Eigen::Vector3d > models;
+    vector< vector< int > > inliers;
+    const bool found = ransac.EstimateModels( points, &models, &inliers );
+    cout << "models:" << models.size() << endl;
+    if ( !found || models.size() != 2 || inliers.size() != 2 )
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Each planted line is found once, with most of its points and few other
+    // points. A datum is never assigned to both models.
+    bool success = true;
+    vector< int > num_assignments( points.size(), 0 );
+    bool found_line[2] = { false, false };
+    for ( int k = 0; k < 2; ++k )
+    {
+        int num_points_per_line[3] = { 0, 0, 0 };
+        for ( const int i : inliers[k] )
+        {
+            ++num_assignments[i];
+            ++num_points_per_line[min( i / num_line_points, 2 )];
+        }
+        const int line = num_points_per_line[0] > num_points_per_line[1] ? 0
+                                                                          : 1;
+        found_line[line] = true;
+        // The model is estimated from a minimal sample, so it is only close
+        // to the planted line: its normal has about the same direction (up to
+        // the sign) and it passes near the point the line was planted at.
+        const double cos_angle =
+            abs( models[k].head< 2 >().dot( lines[line].head< 2 >() ) );
+        const double angle = acos( min( 1.0, cos_angle ) );
+        const double anchor_distance =
+            estimator.Error( anchors[line], models[k] );
+        cout << "model " << k << ": line " << line << ", "
+             << num_points_per_line[line] << " of its points, "
+             << num_points_per_line[1 - line] << " of the other line, "
+             << num_points_per_line[2] << " outliers, angle " << angle
+             << ", anchor distance " << anchor_distance << endl;
+        success = success && num_points_per_line[line] >= 75 &&
+                  num_points_per_line[1 - line] <= 5 && angle < 0.02 &&
+                  anchor_distance < 0.5;
+    }
+    int num_shared = 0;
+    for ( const int num_assigned : num_assignments )
+    {
+        if ( num_assigned > 1 )
+        {
+            ++num_shared;
+        }
+    }
+    cout << "data assigned to both models:" << num_shared << endl;
+
+    return success && found_line[0] && found_line[1] && num_shared == 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
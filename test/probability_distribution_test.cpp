@@ -0,0 +1,145 @@
+//
+// Checks that FitGamma and FitGev recover known parameters from samples of
+// the distributions, and that AliasTable draws each index with a frequency
+// proportional to its weight.
+//
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// theia
+#include <theia/math/probability/alias_table.h>
+#include <theia/math/probability/gamma_distribution.h>
+#include <theia/math/probability/gev_distribution.h>
+
+using namespace std;
+
+namespace {
+// Returns true if the estimate is within the relative tolerance of the true
+// value, or within the tolerance itself for values close to zero.
+bool Close( const double estimate, const double value, const double tolerance )
+{
+    return abs( estimate - value ) <= tolerance * max( 1.0, abs( value ) );
+}
+
+bool CheckGamma( mt19937 *rng, const double k, const double theta )
+{
+    gamma_distribution< double > distribution( k, theta );
+    vector< double > samples( 20000 );
+    for ( double &sample : samples )
+    {
+        sample = distribution( *rng );
+    }
+    double estimated_k = 0.0, estimated_theta = 0.0;
+    const bool fitted =
+        theia::FitGamma( samples, &estimated_k, &estimated_theta );
+    cout << "gamma k=" << k << " theta=" << theta << ": k=" << estimated_k
+         << " theta=" << estimated_theta << endl;
+    return fitted && Close( estimated_k, k, 0.05 ) &&
+           Close( estimated_theta, theta, 0.05 );
+}
+
+// Draws the GEV samples by inverting the cumulative distribution function.
+bool CheckGev( mt19937 *rng,
+               const theia::GevFittingMethod fitting_method,
+               const double mu,
+               const double sigma,
+               const double xi )
+{
+    uniform_real_distribution< double > distribution( 0.0, 1.0 );
+    vector< double > samples( 20000 );
+    for ( double &sample : samples )
+    {
+        const double u = max( distribution( *rng ), 1e-300 );
+        sample = mu + sigma * ( pow( -log( u ), -xi ) - 1.0 ) / xi;
+    }
+    double estimated_mu = 0.0, estimated_sigma = 0.0, estimated_xi = 0.0;
+    const bool fitted = theia::FitGev( samples, fitting_method, &estimated_mu,
+                                       &estimated_sigma, &estimated_xi );
+    cout << "gev method " << fitting_method << " mu=" << mu
+         << " sigma=" << sigma << " xi=" << xi << ": mu=" << estimated_mu
+         << " sigma=" << estimated_sigma << " xi=" << estimated_xi << endl;
+    return fitted && Close( estimated_mu, mu, 0.05 ) &&
+           Close( estimated_sigma, sigma, 0.05 ) &&
+           abs( estimated_xi - xi ) < 0.05;
+}
+
+// Compares the frequencies of many draws with the normalized weights.
+bool CheckAliasTable( mt19937 *rng, const vector< double > &weights )
+{
+    theia::AliasTable alias_table;
+    if ( !alias_table.Build( weights ) )
+    {
+        return false;
+    }
+    const int num_draws = 1000000;
+    vector< int > counts( weights.size(), 0 );
+    for ( int i = 0; i < num_draws; ++i )
+    {
+        ++counts[alias_table.Sample( rng )];
+    }
+
+    double sum = 0.0;
+    for ( const double weight : weights )
+    {
+        sum += weight;
+    }
+    double max_difference = 0.0;
+    bool drew_zero_weight = false;
+    for ( int i = 0; i < weights.size(); ++i )
+    {
+        const double frequency = static_cast< double >( counts[i] ) / num_draws;
+        max_difference =
+            max( max_difference, abs( frequency - weights[i] / sum ) );
+        if ( weights[i] == 0.0 && counts[i] > 0 )
+        {
+            drew_zero_weight = true;
+        }
+    }
+    cout << "alias table of " << weights.size()
+         << " weights: max frequency difference " << max_difference << endl;
+    // The standard deviation of each frequency is at most 0.0005.
+    return max_difference < 0.003 && !drew_zero_weight;
+}
+}  // namespace
+
+int main()
+{
+    mt19937 rng( 42 );
+    bool success = true;
+
+    success &= CheckGamma( &rng, 0.7, 2.0 );
+    success &= CheckGamma( &rng, 3.5, 0.1 );
+
+    for ( const theia::GevFittingMethod fitting_method :
+          { theia::PROBABILITY_WEIGHTED_MOMENTS, theia::MAXIMUM_LIKELIHOOD,
+            theia::QUANTILE_LEAST_SQUARES } )
+    {
+        success &= CheckGev( &rng, fitting_method, 1.0, 0.5, 0.2 );
+        success &= CheckGev( &rng, fitting_method, -2.0, 0.3, -0.25 );
+    }
+
+    success &= CheckAliasTable( &rng, { 1.0, 2.0, 3.0, 4.0 } );
+    success &= CheckAliasTable( &rng, { 0.0, 5.0, 0.5, 0.0, 20.0, 1e-3, 7.0 } );
+    vector< double > many_weights( 100 );
+    for ( int i = 0; i < many_weights.size(); ++i )
+    {
+        many_weights[i] = ( i % 3 ) * ( i + 1 );
+    }
+    success &= CheckAliasTable( &rng, many_weights );
+
+    // A table without any weight cannot be sampled.
+    theia::AliasTable empty_alias_table;
+    const bool rejected_zero_weights =
+        !empty_alias_table.Build( vector< double >( 5, 0.0 ) );
+    cout << "zero weights:"
+         << ( rejected_zero_weights ? "rejected" : "accepted" ) << endl;
+    success &= rejected_zero_weights;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
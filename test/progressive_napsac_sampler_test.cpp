@@ -0,0 +1,135 @@
+//
+// Checks that the local samples of ProgressiveNapsacSampler are made of
+// distinct points of the cell of their center, and that the bucketing of the
+// points stays valid over many draws, i.e. that every point of a cell keeps
+// being drawn and that no point leaks into another cell.
+//
+
+// STL
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+// theia
+#include <theia/solvers/progressive_napsac_sampler.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const int sample_size = 3;
+    // The quadrants of the unit square are the cells of the finest of two
+    // levels. The last quadrant has too few points for a sample, so its
+    // points start at the coarsest level, which is the whole square.
+    const int cluster_sizes[4] = { 6, 5, 8, 2 };
+    const Eigen::Vector2d cluster_centers[4] = {
+        Eigen::Vector2d( 0.25, 0.25 ), Eigen::Vector2d( 0.75, 0.25 ),
+        Eigen::Vector2d( 0.25, 0.75 ), Eigen::Vector2d( 0.75, 0.75 ) };
+    vector< Eigen::Vector2d > positions;
+    vector< int > point_cell;
+    for ( int cell = 0; cell < 4; ++cell )
+    {
+        for ( int i = 0; i < cluster_sizes[cell]; ++i )
+        {
+            positions.push_back(
+                cluster_centers[cell] +
+                Eigen::Vector2d( theia::RandDouble( -0.2, 0.2 ),
+                                 theia::RandDouble( -0.2, 0.2 ) ) );
+            point_cell.push_back( cell );
+        }
+    }
+    // Pin the extent of the positions to the unit square.
+    positions[0] = Eigen::Vector2d( 0.0, 0.0 );
+    positions.back() = Eigen::Vector2d( 1.0, 1.0 );
+    const int num_points = positions.size();
+    vector< int > data( num_points );
+    for ( int i = 0; i < num_points; ++i )
+    {
+        data[i] = i;
+    }
+
+    // Blending toward global sampling is made negligible by restarting the
+    // sampler often, and the seed is fixed so that the draws are repeatable.
+    theia::ProgressiveNapsacSampler< int > sampler( sample_size, 2, INT_MAX );
+    sampler.Initialize();
+    sampler.SetSeed( 1234 );
+    sampler.SetPositions( &positions );
+
+    const int num_restarts = 200;
+    const int num_draws_per_restart = 200;
+    int num_invalid_samples = 0;
+    int num_local_samples = 0;
+    // The points drawn together with a center from its own cell.
+    vector< set< int > > drawn_in_cell( num_points );
+    vector< int > subset;
+    for ( int restart = 0; restart < num_restarts; ++restart )
+    {
+        sampler.Reset();
+        // The level of each center and the number of samples drawn with it
+        // at that level, following the progression of the sampler.
+        vector< int > center_level( num_points );
+        vector< int > center_hits( num_points, 0 );
+        for ( int i = 0; i < num_points; ++i )
+        {
+            center_level[i] = cluster_sizes[point_cell[i]] < sample_size;
+        }
+
+        for ( int draw = 0; draw < num_draws_per_restart; ++draw )
+        {
+            sampler.Sample( data, &subset );
+            const vector< int > &indices = sampler.SampleIndices();
+            set< int > distinct_indices( indices.begin(), indices.end() );
+            if ( subset != indices ||
+                 distinct_indices.size() != sample_size )
+            {
+                ++num_invalid_samples;
+                continue;
+            }
+
+            const int center = indices[0];
+            if ( center_level[center] > 0 )
+            {
+                continue;
+            }
+            ++num_local_samples;
+            for ( const int index : indices )
+            {
+                if ( point_cell[index] != point_cell[center] )
+                {
+                    ++num_invalid_samples;
+                }
+                drawn_in_cell[center].insert( index );
+            }
+            if ( ++center_hits[center] >= cluster_sizes[point_cell[center]] )
+            {
+                center_level[center] = 1;
+            }
+        }
+    }
+
+    // Every point of a cell of the finest level is eventually drawn with
+    // every center of that cell.
+    int num_missing_points = 0;
+    for ( int center = 0; center < num_points; ++center )
+    {
+        if ( cluster_sizes[point_cell[center]] >= sample_size &&
+             drawn_in_cell[center].size() !=
+                 cluster_sizes[point_cell[center]] )
+        {
+            ++num_missing_points;
+        }
+    }
+
+    cout << "local samples:" << num_local_samples << endl;
+    cout << "invalid samples:" << num_invalid_samples << endl;
+    cout << "centers missing points of their cell:" << num_missing_points
+         << endl;
+    return num_local_samples > 0 && num_invalid_samples == 0 &&
+                   num_missing_points == 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+//
+// Checks that ProsacSampler draws its kth sample from the top-ranked points
+// given by an independent evaluation of the growth function of PROSAC, both
+// for data sorted by quality and through a quality ordering.
+//
+
+// STL
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+// theia
+#include <theia/solvers/prosac_sampler.h>
+#include <theia/util/random.h>
+
+using namespace std;
+
+namespace {
+// The size n of the set of top-ranked points that the kth sample is drawn
+// from, for k = 1, ..., num_samples: the smallest n with T'_n >= k (Eq. 5 of
+// the PROSAC paper), with T_m = 20000 * C(m, m) / C(N, m) and T'_m = 1.
+vector< int > GrowthFunction( const int num_data,
+                              const int sample_size,
+                              const int num_samples )
+{
+    double t_n = 20000.0;
+    for ( int i = 0; i < sample_size; ++i )
+    {
+        t_n *= static_cast< double >( sample_size - i ) / ( num_data - i );
+    }
+    int n = sample_size;
+    int t_n_prime = 1;
+    vector< int > sizes( num_samples + 1, 0 );
+    for ( int k = 1; k <= num_samples; ++k )
+    {
+        while ( k > t_n_prime && n < num_data )
+        {
+            const double t_n_plus1 = t_n * ( n + 1.0 ) /
+                                     ( n + 1.0 - sample_size );
+            t_n_prime += ceil( t_n_plus1 - t_n );
+            t_n = t_n_plus1;
+            ++n;
+        }
+        sizes[k] = n;
+    }
+    return sizes;
+}
+
+// Draws num_samples samples and counts those that are not made of distinct
+// points of rank below n(k), with the point of rank n(k) - 1 last as long as
+// the set is still growing.
+int CountInvalidSamples( const vector< int > *quality_order,
+                         const int num_data,
+                         const int sample_size,
+                         const int num_samples )
+{
+    vector< int > data( num_data );
+    vector< int > rank( num_data );
+    for ( int i = 0; i < num_data; ++i )
+    {
+        data[i] = i;
+        rank[quality_order != nullptr ? ( *quality_order )[i] : i] = i;
+    }
+    const vector< int > sizes =
+        GrowthFunction( num_data, sample_size, num_samples );
+
+    theia::ProsacSampler< int > sampler( sample_size );
+    sampler.Initialize();
+    sampler.SetQualityOrder( quality_order );
+    int num_invalid_samples = 0;
+    vector< int > subset;
+    for ( int k = 1; k <= num_samples; ++k )
+    {
+        sampler.Sample( data, &subset );
+        const set< int > distinct_points( subset.begin(), subset.end() );
+        bool valid = subset == sampler.SampleIndices() &&
+                     distinct_points.size() == sample_size;
+        for ( const int point : subset )
+        {
+            valid = valid && rank[point] < sizes[k];
+        }
+        if ( sizes[k] < num_data )
+        {
+            valid = valid && rank[subset.back()] == sizes[k] - 1;
+        }
+        if ( !valid )
+        {
+            ++num_invalid_samples;
+        }
+    }
+    return num_invalid_samples;
+}
+}  // namespace
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const int num_data = 300;
+    const int sample_size = 3;
+    const int num_samples = 30000;
+
+    // The first sample is made of the three best points.
+    const vector< int > sizes =
+        GrowthFunction( num_data, sample_size, num_samples );
+    cout << "top-ranked points of samples 1, 100, 1000, 10000:" << sizes[1]
+         << " " << sizes[100] << " " << sizes[1000] << " " << sizes[10000]
+         << endl;
+
+    const int num_invalid_sorted_samples =
+        CountInvalidSamples( nullptr, num_data, sample_size, num_samples );
+    cout << "invalid samples of sorted data:" << num_invalid_sorted_samples
+         << endl;
+
+    vector< int > quality_order( num_data );
+    for ( int i = 0; i < num_data; ++i )
+    {
+        quality_order[i] = i;
+    }
+    for ( int i = num_data - 1; i > 0; --i )
+    {
+        swap( quality_order[i], quality_order[theia::RandInt( 0, i )] );
+    }
+    const int num_invalid_ordered_samples = CountInvalidSamples(
+        &quality_order, num_data, sample_size, num_samples );
+    cout << "invalid samples through a quality ordering:"
+         << num_invalid_ordered_samples << endl;
+
+    return sizes[1] == sample_size && sizes[num_samples] == num_data &&
+                   num_invalid_sorted_samples == 0 &&
+                   num_invalid_ordered_samples == 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
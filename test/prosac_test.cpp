@@ -0,0 +1,81 @@
+//
+// Checks that PROSAC terminates much earlier than RANSAC when the points of
+// highest quality are inliers, on a line whose inliers are a small fraction of
+// the data but make up the whole prefix of the quality ordering.
+//
+
+// STL
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/prosac.h>
+#include <theia/solvers/ransac.h>
+#include <theia/util/random.h>
+
+#include "line_estimator.h"
+
+using namespace std;
+
+int main()
+{
+    theia::InitRandomGenerator();
+    const double size = 100.0;
+    const Eigen::Vector3d line =
+        synthetic_lines::Line( Eigen::Vector2d( 30.0, 60.0 ), 0.3 );
+
+    // The data is sorted by quality: 40 inliers, followed by outliers and 20
+    // more inliers in random order. The noise is low enough for any two
+    // inliers to give a line that keeps most of the others, since PROSAC
+    // stops as soon as the model of its first samples is supported by the
+    // top-ranked points.
+    vector< Eigen::Vector2d > points;
+    synthetic_lines::AddLinePoints( line, 40, 0.02, size, &points );
+    vector< Eigen::Vector2d > remaining_points;
+    synthetic_lines::AddLinePoints( line, 20, 0.02, size, &remaining_points );
+    synthetic_lines::AddUniformPoints( 440, size, &remaining_points );
+    for ( int i = remaining_points.size() - 1; i > 0; --i )
+    {
+        swap( remaining_points[i],
+              remaining_points[theia::RandInt( 0, i )] );
+    }
+    points.insert( points.end(), remaining_points.begin(),
+                   remaining_points.end() );
+
+    theia::RansacParameters ransac_params;
+    ransac_params.error_thresh = 0.5;
+    ransac_params.min_iterations = 1;
+    synthetic_lines::LineEstimator estimator;
+
+    theia::Ransac< synthetic_lines::LineEstimator > ransac( ransac_params,
+                                                            estimator );
+    theia::Prosac< synthetic_lines::LineEstimator > prosac( ransac_params,
+                                                            estimator );
+    ransac.Initialize();
+    prosac.Initialize();
+
+    // Average over a few runs, since the number of RANSAC iterations depends
+    // on the best model found.
+    const int num_runs = 10;
+    int num_ransac_iterations = 0;
+    int num_prosac_iterations = 0;
+    bool found = true;
+    for ( int run = 0; run < num_runs; ++run )
+    {
+        Eigen::Vector3d best_line;
+        theia::RansacSummary summary;
+        ransac.Estimate( points, &best_line, &summary );
+        num_ransac_iterations += summary.num_iterations;
+        found = found && summary.inliers.size() >= 50;
+        prosac.Estimate( points, &best_line, &summary );
+        num_prosac_iterations += summary.num_iterations;
+        found = found && summary.inliers.size() >= 50;
+    }
+    cout << "ransac iterations:" << num_ransac_iterations / num_runs << endl;
+    cout << "prosac iterations:" << num_prosac_iterations / num_runs << endl;
+
+    return found && 10 * num_prosac_iterations < num_ransac_iterations
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
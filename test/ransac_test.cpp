@@ -88,4 +88,14 @@ int main()
         cout << summary.inliers[i] << " ";
     }
     cout << endl;
+
+    // The same estimation through the virtual Estimator interface.
+    typedef ransac_estimators::Estimator< ransac_estimators::Match2D3D,
+                                          Eigen::Matrix< double, 3, 4 > > VirtualP3PEstimator;
+    ransac_estimators::VirtualEstimatorAdapter< ransac_estimators::P3PEstimator > adapter( estimator );
+    const VirtualP3PEstimator &virtual_estimator( adapter );
+    ransac_estimators::Ransac< VirtualP3PEstimator > virtual_ransac( ransac_params, virtual_estimator );
+    virtual_ransac.Initialize();
+    virtual_ransac.Estimate( data, &best_model, &summary );
+    cout << "inliers through the virtual interface:" << summary.inliers.size() << endl;
 }
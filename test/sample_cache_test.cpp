@@ -0,0 +1,167 @@
+//
+// Checks which samples the sample cache treats as repeated, and that the cache
+// cannot keep the estimation from terminating when the sampler can only draw a
+// few of the minimal samples, e.g. a NAPSAC neighborhood or correspondences
+// with zero sampling weight.
+//
+
+// STL
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// theia
+#include <theia/solvers/sample_cache.h>
+#include <theia/solvers/sample_consensus_estimator.h>
+#include <theia/solvers/sampler.h>
+#include <theia/util/random.h>
+
+// P3P
+#include "ransac_estimators.h"
+
+using namespace std;
+
+namespace {
+// Draws random samples of the first num_support data points only, so that at
+// most C(num_support, sample size) distinct samples are ever drawn.
+class SupportSampler : public theia::Sampler< ransac_estimators::Match2D3D >
+{
+public:
+    SupportSampler( int min_num_samples, int num_support ):
+        theia::Sampler< ransac_estimators::Match2D3D >( min_num_samples ),
+        num_support_( num_support ){}
+
+    bool Initialize()
+    {
+        theia::InitRandomGenerator();
+        return true;
+    }
+
+    bool Sample( const vector< ransac_estimators::Match2D3D > &data,
+                 vector< ransac_estimators::Match2D3D > *subset )
+    {
+        subset->resize( min_num_samples_ );
+        sample_indices_.resize( min_num_samples_ );
+        vector< int > support( num_support_ );
+        for ( int i = 0; i < num_support_; ++i )
+        {
+            support[i] = i;
+        }
+        for ( int i = 0; i < min_num_samples_; ++i )
+        {
+            swap( support[i], support[theia::RandInt( i, num_support_ - 1 )] );
+            sample_indices_[i] = support[i];
+            (*subset)[i] = data[support[i]];
+        }
+        return true;
+    }
+
+private:
+    int num_support_;
+};
+
+class SupportRansac :
+    public theia::SampleConsensusEstimator< ransac_estimators::P3PEstimator >
+{
+public:
+    SupportRansac( const theia::RansacParameters &ransac_params,
+                   const ransac_estimators::P3PEstimator &estimator ):
+        theia::SampleConsensusEstimator< ransac_estimators::P3PEstimator >(
+            ransac_params, estimator ){}
+
+    bool Initialize()
+    {
+        return theia::SampleConsensusEstimator<
+            ransac_estimators::P3PEstimator >::Initialize(
+                new SupportSampler( estimator_.SampleSize(), 4 ) );
+    }
+};
+
+// Checks which samples the cache treats as repeated, with and without order.
+bool CheckRepeatedSamples()
+{
+    bool success = true;
+    theia::SampleCache cache;
+    cache.Reset( 10, 4 );
+    success = success && cache.Insert( { 1, 2, 3, 4 } );
+    success = success && !cache.Insert( { 4, 3, 2, 1 } );
+    cache.Reset( 10, 4, true );
+    success = success && cache.Insert( { 1, 2, 3, 4 } );
+    success = success && cache.Insert( { 1, 2, 4, 3 } );
+    success = success && !cache.Insert( { 1, 2, 4, 3 } );
+
+    // Every sample of 5 data points, after which the cache is exhausted. The
+    // samples are kept when the data grows.
+    cache.Reset( 5, 3 );
+    for ( int i = 0; i < 5; ++i )
+    {
+        for ( int j = i + 1; j < 5; ++j )
+        {
+            for ( int k = j + 1; k < 5; ++k )
+            {
+                success = success && !cache.Exhausted() &&
+                          cache.Insert( { k, j, i } );
+            }
+        }
+    }
+    success = success && cache.Exhausted();
+    cache.Grow( 6 );
+    success = success && !cache.Exhausted() && !cache.Insert( { 0, 1, 2 } ) &&
+              cache.Insert( { 0, 1, 5 } );
+    return success;
+}
+}  // namespace
+
+int main()
+{
+    if ( !CheckRepeatedSamples() )
+    {
+        cout << "repeated samples:wrong" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // load data
+    ifstream ifs("../test/data.txt", ifstream::in );
+    assert( ifs.is_open() );
+    int n, n_inliers;
+    ifs >> n >> n_inliers;
+    vector< ransac_estimators::Match2D3D > data( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y;
+        ifs >> x >> y;
+        data[i].featureVector = Eigen::Vector3d( x, y, 1.0 ).normalized();
+    }
+    for ( int i = 0; i < n; ++i )
+    {
+        float x, y, z;
+        ifs >> x >> y >> z;
+        data[i].worldPoint = Eigen::Vector3d( x, y, z );
+    }
+    ifs.close();
+
+    ransac_estimators::RansacParameters ransac_params;
+    ransac_params.error_thresh = 1e-2;
+    ransac_params.max_iterations = 1000;
+    ransac_params.use_sample_cache = true;
+    ransac_params.use_exhaustive_enumeration = false;
+
+    ransac_estimators::P3PEstimator estimator;
+    SupportRansac ransac( ransac_params, estimator );
+    ransac.Initialize();
+    ransac_estimators::RansacSummary summary;
+    Eigen::Matrix< double, 3, 4 > best_model;
+
+    // Only 4 distinct samples can be drawn, so all but the first few samples
+    // are duplicates and the cache is never exhausted.
+    ransac.Estimate( data, &best_model, &summary );
+
+    cout << "iterations:" << summary.num_iterations << endl;
+    cout << "duplicate samples:" << summary.num_duplicate_samples << endl;
+    const bool terminated =
+        summary.num_iterations <= ransac_params.max_iterations &&
+        summary.num_duplicate_samples <= 2 * ransac_params.max_iterations;
+    return terminated ? EXIT_SUCCESS : EXIT_FAILURE;
+}